@@ -0,0 +1,15 @@
+#import <Foundation/Foundation.h>
+
+/*
+ * Time spent at the generation barriers of a run, where each generation's evaluations are shared among workers.
+ * idleSeconds is, summed over workers and barriers, the time a worker had nothing left to evaluate
+ * while others were still busy (plus scheduling overhead).
+ */
+typedef struct {
+    double wallSeconds;
+    double busySeconds;
+    double idleSeconds;
+    int workers; //Most workers used at any barrier.
+    int barriers;
+    long long evaluations;
+} BarrierTiming;
@@ -0,0 +1,20 @@
+#import <Foundation/Foundation.h>
+#import "Team.h"
+#import "Utilities.h"
+
+/*
+ * Covariance matrix adaptation evolution strategy over the Team genome, an alternative to GA.
+ * Each call to breedPopulation:AtGeneration:andMaxGeneration: updates the search distribution from the fitness
+ * of the population just evaluated, then overwrites the population with new samples from it.
+ * Genes are searched in a normalized box mapped onto the ranges initRandom draws from (see Team),
+ * and the strategy restarts from a random mean whenever it converges or stops improving.
+ */
+@interface CMAES : NSObject
+
+-(void) breedPopulation:(NSMutableArray*)population AtGeneration:(int)generation andMaxGeneration:(int)maxGenerations;
+
+@property (nonatomic) float initialSigma; //Step size, in normalized units, at the start of every restart.
+@property (readonly, nonatomic) float sigma;
+@property (readonly, nonatomic) int restartCount;
+
+@end
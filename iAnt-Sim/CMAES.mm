@@ -0,0 +1,290 @@
+#import "CMAES.h"
+
+using namespace std;
+
+#define CMAES_DIMENSIONS TEAM_PARAMETER_COUNT
+#define CMAES_TOLERANCE_X 1e-5 //Restart once steps shrink below this (normalized units).
+#define CMAES_MAX_CONDITION 1e14 //Restart once the covariance matrix becomes this ill-conditioned.
+#define CMAES_RESAMPLE_LIMIT 10 //Samples outside the box are redrawn this many times before being clamped.
+
+@implementation CMAES {
+    double lower[CMAES_DIMENSIONS];
+    double upper[CMAES_DIMENSIONS];
+
+    //Strategy parameters, set up for the population size on the first call.
+    int lambda;
+    int mu;
+    vector<double> weights;
+    double mueff, cc, cs, c1, cmu, damps, chiN;
+
+    //Distribution state
+    double mean[CMAES_DIMENSIONS];
+    double pc[CMAES_DIMENSIONS]; //Evolution path of the covariance matrix.
+    double ps[CMAES_DIMENSIONS]; //Conjugate evolution path of the step size.
+    double C[CMAES_DIMENSIONS][CMAES_DIMENSIONS];
+    double B[CMAES_DIMENSIONS][CMAES_DIMENSIONS]; //Eigenvectors of C as columns.
+    double D[CMAES_DIMENSIONS]; //Square roots of the eigenvalues of C.
+    int iteration; //Updates since the last restart.
+    BOOL sampled; //NO until the population holds samples drawn from the distribution.
+    vector<float> bestFitness; //Best fitness of each generation since the last restart.
+}
+
+@synthesize initialSigma, sigma, restartCount;
+
+-(id) init {
+    if(self = [super init]) {
+        float lowerBounds[CMAES_DIMENSIONS], upperBounds[CMAES_DIMENSIONS];
+        [Team getGenomeLowerBounds:lowerBounds upperBounds:upperBounds];
+        for(int i = 0; i < CMAES_DIMENSIONS; i++) {
+            lower[i] = lowerBounds[i];
+            upper[i] = upperBounds[i];
+        }
+        initialSigma = 0.3;
+        lambda = 0;
+        restartCount = 0;
+        sampled = NO;
+    }
+    return self;
+}
+
+/*
+ * Default strategy parameters (Hansen, "The CMA Evolution Strategy: A Tutorial") for lambda offspring.
+ */
+-(void) setUpForPopulationSize:(int)populationSize {
+    double n = CMAES_DIMENSIONS;
+    lambda = populationSize;
+    mu = lambda / 2;
+
+    weights.resize(mu);
+    double sum = 0., sumOfSquares = 0.;
+    for(int i = 0; i < mu; i++) {
+        weights[i] = log(mu + 0.5) - log(i + 1.);
+        sum += weights[i];
+    }
+    for(int i = 0; i < mu; i++) {
+        weights[i] /= sum;
+        sumOfSquares += weights[i] * weights[i];
+    }
+    mueff = 1. / sumOfSquares;
+
+    cc = (4. + mueff / n) / (n + 4. + 2. * mueff / n);
+    cs = (mueff + 2.) / (n + mueff + 5.);
+    c1 = 2. / ((n + 1.3) * (n + 1.3) + mueff);
+    cmu = MIN(1. - c1, 2. * (mueff - 2. + 1. / mueff) / ((n + 2.) * (n + 2.) + mueff));
+    damps = 1. + 2. * MAX(0., sqrt((mueff - 1.) / (n + 1.)) - 1.) + cs;
+    chiN = sqrt(n) * (1. - 1. / (4. * n) + 1. / (21. * n * n));
+}
+
+/*
+ * Resets the distribution to an isotropic one of initialSigma around _mean.
+ */
+-(void) restartAt:(const double*)_mean {
+    for(int i = 0; i < CMAES_DIMENSIONS; i++) {
+        mean[i] = _mean[i];
+        pc[i] = ps[i] = 0.;
+        D[i] = 1.;
+        for(int j = 0; j < CMAES_DIMENSIONS; j++) {
+            C[i][j] = B[i][j] = (i == j) ? 1. : 0.;
+        }
+    }
+    sigma = initialSigma;
+    iteration = 0;
+    bestFitness.clear();
+}
+
+/*
+ * Recomputes B and D from C.
+ */
+-(void) decomposeCovariance {
+    cv::Mat_<double> covariance(CMAES_DIMENSIONS, CMAES_DIMENSIONS);
+    for(int i = 0; i < CMAES_DIMENSIONS; i++) {
+        for(int j = 0; j < CMAES_DIMENSIONS; j++) {
+            covariance(i, j) = C[i][j] = C[j][i] = (i >= j) ? C[i][j] : C[j][i]; //Updates only fill the lower triangle.
+        }
+    }
+
+    cv::Mat_<double> eigenvalues, eigenvectors;
+    cv::eigen(covariance, eigenvalues, eigenvectors);
+    for(int j = 0; j < CMAES_DIMENSIONS; j++) {
+        D[j] = sqrt(MAX(eigenvalues(j), 1e-20));
+        for(int i = 0; i < CMAES_DIMENSIONS; i++) {
+            B[i][j] = eigenvectors(j, i); //OpenCV returns eigenvectors as rows.
+        }
+    }
+}
+
+/*
+ * Returns YES if the strategy has converged, become ill-conditioned or stopped improving, so it should restart.
+ * Stagnation means the median best fitness over the last third of a window of generations
+ * is no better than over its first third.
+ */
+-(BOOL) shouldRestart {
+    double maxD = D[0], minD = D[0];
+    for(int i = 1; i < CMAES_DIMENSIONS; i++) {
+        maxD = MAX(maxD, D[i]);
+        minD = MIN(minD, D[i]);
+    }
+    if((sigma * maxD < CMAES_TOLERANCE_X) || ((maxD / minD) * (maxD / minD) > CMAES_MAX_CONDITION)) {
+        return YES;
+    }
+
+    int window = 10 + (int)ceil(30. * CMAES_DIMENSIONS / lambda);
+    if((int)bestFitness.size() < window) {
+        return NO;
+    }
+    int third = window / 3;
+    vector<float> early(bestFitness.end() - window, bestFitness.end() - window + third);
+    vector<float> late(bestFitness.end() - third, bestFitness.end());
+    nth_element(early.begin(), early.begin() + third / 2, early.end());
+    nth_element(late.begin(), late.begin() + third / 2, late.end());
+    return late[third / 2] <= early[third / 2];
+}
+
+/*
+ * Moves the distribution towards the best mu members of the population (ranked by decreasing fitness).
+ */
+-(void) updateFromRanked:(NSArray*)ranked {
+    const int n = CMAES_DIMENSIONS;
+    vector<double> steps(mu * n); //(x_i - oldMean) / sigma for the best mu samples.
+    float genome[n];
+    double oldMean[n];
+    memcpy(oldMean, mean, sizeof(mean));
+
+    for(int i = 0; i < n; i++) {
+        mean[i] = 0.;
+    }
+    for(int k = 0; k < mu; k++) {
+        [[ranked objectAtIndex:k] getGenome:genome];
+        for(int i = 0; i < n; i++) {
+            double x = (genome[i] - lower[i]) / (upper[i] - lower[i]);
+            steps[k * n + i] = (x - oldMean[i]) / sigma;
+            mean[i] += weights[k] * x;
+        }
+    }
+    iteration++;
+
+    //Step size path, using C^(-1/2) = B diag(1/D) B^T.
+    double meanStep[n], rotated[n];
+    for(int i = 0; i < n; i++) {
+        meanStep[i] = (mean[i] - oldMean[i]) / sigma;
+    }
+    for(int j = 0; j < n; j++) {
+        rotated[j] = 0.;
+        for(int i = 0; i < n; i++) {
+            rotated[j] += B[i][j] * meanStep[i];
+        }
+        rotated[j] /= D[j];
+    }
+    double psNorm = 0.;
+    for(int i = 0; i < n; i++) {
+        double whitened = 0.;
+        for(int j = 0; j < n; j++) {
+            whitened += B[i][j] * rotated[j];
+        }
+        ps[i] = (1. - cs) * ps[i] + sqrt(cs * (2. - cs) * mueff) * whitened;
+        psNorm += ps[i] * ps[i];
+    }
+    psNorm = sqrt(psNorm);
+
+    //Covariance path, stalled while the step size path is unusually long.
+    BOOL hsig = psNorm / sqrt(1. - pow(1. - cs, 2. * iteration)) / chiN < 1.4 + 2. / (n + 1.);
+    for(int i = 0; i < n; i++) {
+        pc[i] = (1. - cc) * pc[i] + (hsig ? sqrt(cc * (2. - cc) * mueff) * meanStep[i] : 0.);
+    }
+
+    //Rank-one and rank-mu covariance updates.
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j <= i; j++) {
+            double rankMu = 0.;
+            for(int k = 0; k < mu; k++) {
+                rankMu += weights[k] * steps[k * n + i] * steps[k * n + j];
+            }
+            C[i][j] = (1. - c1 - cmu) * C[i][j]
+                    + c1 * (pc[i] * pc[j] + (hsig ? 0. : cc * (2. - cc) * C[i][j]))
+                    + cmu * rankMu;
+        }
+    }
+
+    sigma *= exp((cs / damps) * (psNorm / chiN - 1.));
+    [self decomposeCovariance];
+}
+
+/*
+ * Updates the distribution from the evaluated population and replaces every member with a new sample.
+ * The very first population (e.g. from initRandom) was not drawn from the distribution, so it only seeds the mean.
+ */
+-(void) breedPopulation:(NSMutableArray*)population AtGeneration:(int)generation andMaxGeneration:(int)maxGenerations {
+    const int n = CMAES_DIMENSIONS;
+    int populationSize = (int)[population count];
+    if(populationSize < 2) {
+        return;
+    }
+    if(populationSize != lambda) {
+        [self setUpForPopulationSize:populationSize];
+        sampled = NO;
+    }
+
+    //Sort array largest to smallest; screened teams only have a predicted fitness, so they rank below all simulated ones.
+    NSArray* ranked = [population sortedArrayUsingComparator:^NSComparisonResult(id objA, id objB) {
+        if([objA screened] != [objB screened]) {
+            return [objA screened] ? NSOrderedDescending : NSOrderedAscending;
+        }
+        return [@([objB fitness]) compare:@([objA fitness])];
+    }];
+
+    if(sampled) {
+        [self updateFromRanked:ranked];
+        bestFitness.push_back([[ranked objectAtIndex:0] fitness]);
+        if([self shouldRestart]) {
+            double randomMean[n];
+            for(int i = 0; i < n; i++) {
+                randomMean[i] = randomFloat(1.);
+            }
+            [self restartAt:randomMean];
+            restartCount++;
+        }
+    }
+    else {
+        //Seed the mean with a weighted recombination of the best mu members.
+        double seedMean[n];
+        float genome[n];
+        for(int i = 0; i < n; i++) {
+            seedMean[i] = 0.;
+        }
+        for(int k = 0; k < mu; k++) {
+            [[ranked objectAtIndex:k] getGenome:genome];
+            for(int i = 0; i < n; i++) {
+                seedMean[i] += weights[k] * MIN(MAX((genome[i] - lower[i]) / (upper[i] - lower[i]), 0.), 1.);
+            }
+        }
+        [self restartAt:seedMean];
+        sampled = YES;
+    }
+
+    //Draw new members mean + sigma * B * D * z, redrawing (then clamping) samples outside the box.
+    float genome[n];
+    for(Team* team in population) {
+        double x[n];
+        BOOL inside = NO;
+        for(int attempt = 0; attempt < CMAES_RESAMPLE_LIMIT && !inside; attempt++) {
+            double scaled[n];
+            for(int j = 0; j < n; j++) {
+                scaled[j] = D[j] * randomNormal(0., 1.);
+            }
+            inside = YES;
+            for(int i = 0; i < n; i++) {
+                x[i] = mean[i];
+                for(int j = 0; j < n; j++) {
+                    x[i] += sigma * B[i][j] * scaled[j];
+                }
+                inside = inside && (x[i] >= 0.) && (x[i] <= 1.);
+            }
+        }
+        for(int i = 0; i < n; i++) {
+            genome[i] = lower[i] + MIN(MAX(x[i], 0.), 1.) * (upper[i] - lower[i]);
+        }
+        [team setGenome:genome];
+    }
+}
+
+@end
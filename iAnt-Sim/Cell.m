@@ -1,10 +1,20 @@
 #import "Cell.h"
+#import "MemoryMonitor.h"
 
 @implementation Cell
 
 @synthesize tag, region;
 @synthesize isClustered, isExplored;
 
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassCell);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassCell);
+}
+
 -(id)init {
     if (self = [super init]) {
         tag = nil;
@@ -8,6 +8,7 @@
 
 #ifdef __cplusplus
 +(cv::EM) trainOptimalEMWith:(NSMutableArray*)foundTags;
++(cv::EM) trainOptimalEMWithPoints:(const std::vector<NSPoint>&)points;
 #endif
 
 @property (nonatomic) NSPoint center;
@@ -1,10 +1,20 @@
 #import "Cluster.h"
+#import "MemoryMonitor.h"
 
 @implementation Cluster
 
 @synthesize center;
 @synthesize width, height;
 
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassCluster);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassCluster);
+}
+
 
 -(id) initWithCenter:(NSPoint)_center width:(int)_width andHeight:(int)_height {
     if(self = [super init]) {
@@ -15,26 +25,38 @@
     return self;
 }
 
+/*
+ * Executes unsupervised clustering algorithm Expectation-Maximization (EM) on the positions of foundTags
+ */
++(cv::EM) trainOptimalEMWith:(NSMutableArray*)foundTags {
+    std::vector<NSPoint> points;
+    points.reserve([foundTags count]);
+    for (Tag* tag in foundTags) {
+        points.push_back([tag position]);
+    }
+    return [self trainOptimalEMWithPoints:points];
+}
+
 /*
  * Executes unsupervised clustering algorithm Expectation-Maximization (EM) on input
  * Returns trained instantiation of EM if all robots home, untrained otherwise
  */
-+(cv::EM) trainOptimalEMWith:(NSMutableArray*)foundTags {
++(cv::EM) trainOptimalEMWithPoints:(const std::vector<NSPoint>&)points {
     int k = 0; //number of clusters
     
     cv::EM emModel;
     float emBIC = std::numeric_limits<float>::infinity();
     
     //Run EM on aggregate tag array
-    if ([foundTags count]) {
-        //Create [totalFoundTags count] x 2 matrix
-        cv::Mat aggregate((int)[foundTags count], 2, CV_64F);
+    if (points.size()) {
+        //Create [points count] x 2 matrix
+        cv::Mat aggregate((int)points.size(), 2, CV_64F);
         int counter = 0;
         //Iterate over all tags
-        for (Tag* tag in foundTags) {
+        for (const NSPoint& point : points) {
             //Copy x and y location of tag into matrix
-            aggregate.at<double>(counter, 0) = [tag position].x;
-            aggregate.at<double>(counter, 1) = [tag position].y;
+            aggregate.at<double>(counter, 0) = point.x;
+            aggregate.at<double>(counter, 1) = point.y;
             counter++;
         }
 
@@ -48,7 +70,7 @@
             oldBIC = emBIC;
             k++;
             //Create output array for log likelihood values
-            cv::Mat ll((int)[foundTags count], 1, CV_64F);
+            cv::Mat ll((int)points.size(), 1, CV_64F);
             
             //Train and store model
             emModel = cv::EM(k);
@@ -56,7 +78,7 @@
             
             //Calculate and store BIC
             float llSum = cv::sum(ll)[0];
-            emBIC = bic(llSum, componentsEM(k, 2), (int)[foundTags count]);
+            emBIC = bic(llSum, componentsEM(k, 2), (int)points.size());
 
         } while (emBIC - oldBIC < 0);
         emModel = oldModel;
@@ -16,4 +16,13 @@ static const int ValueDependentVarMutId = 0;
 static const int DecreasingVarMutId = 1;
 static const int FixedVarMutId = 2;
 
+static const int GAOptimizerId = 0;
+static const int CMAESOptimizerId = 1;
+
+static const int CPFABehaviorId = 0;
+static const int SpiralSearchBehaviorId = 1;
+
+static const int PheromoneRecordsModelId = 0;
+static const int PheromoneFieldModelId = 1;
+
 #endif
\ No newline at end of file
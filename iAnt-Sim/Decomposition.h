@@ -1,6 +1,7 @@
 #import <Foundation/Foundation.h>
 #import "Cell.h"
 #import "QuadTree.h"
+#import "TiledGrid.h"
 
 @interface Decomposition : NSObject
 
@@ -9,9 +10,9 @@
 
 #ifdef __cplusplus
 
-@property (nonatomic) std::vector<std::vector<Cell*>> grid;
+@property (nonatomic) TiledGrid grid;
 
--(id) initWithGrid:(std::vector<std::vector<Cell*>>)_grid andExploredCutoff:(float)_exploredCutoff;
+-(id) initWithGrid:(TiledGrid)_grid andExploredCutoff:(float)_exploredCutoff;
 
 -(NSMutableArray*) runDecomposition:(NSMutableArray*)regions;
 -(double) checkExploredness:(QuadTree*)region;
@@ -5,10 +5,10 @@
 @synthesize exploredCutoff, unexploredArea;
 @synthesize grid;
 
--(id) initWithGrid:(std::vector<std::vector<Cell*>>)_grid andExploredCutoff:(float)_exploredCutoff {
+-(id) initWithGrid:(TiledGrid)_grid andExploredCutoff:(float)_exploredCutoff {
     if(self = [super init]) {
         grid = _grid;
-        unexploredArea = grid.size() * grid.at(0).size();
+        unexploredArea = (long)grid.width() * grid.height();
         exploredCutoff = _exploredCutoff;
     }
     return self;
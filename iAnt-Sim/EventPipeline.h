@@ -0,0 +1,124 @@
+#import <Foundation/Foundation.h>
+
+@class Simulation;
+
+typedef enum {
+    SimulationEventPickup,
+    SimulationEventPheromone,
+    SimulationEventTick
+} SimulationEventType;
+
+/*
+ * One observable occurrence inside an evaluation. Fields not listed for a type are unused.
+ */
+typedef struct {
+    SimulationEventType type;
+    int tick;
+    NSPoint position; //Pickups and pheromones.
+    int cluster; //Pickups.
+    float weight; //Pheromones.
+    float decayRate; //Pheromones.
+    void* object; //The picked up Tag or a snapshot of the laid Pheromone, retained until the event is delivered; NULL if none.
+    int remainingTags; //Ticks: tags the team has yet to pick up (see countRemainingTags).
+} SimulationEvent;
+
+#ifdef __cplusplus
+
+#import <atomic>
+#import <condition_variable>
+#import <memory>
+#import <mutex>
+#import <thread>
+#import <vector>
+
+#define EVENT_RING_CAPACITY 4096 //Power of two.
+
+/*
+ * Single-producer single-consumer ring of events; the producer is one worker thread, the consumer the pipeline thread.
+ */
+class EventRing {
+    SimulationEvent events[EVENT_RING_CAPACITY];
+    alignas(64) std::atomic<size_t> head; //Total events pushed.
+    alignas(64) std::atomic<size_t> tail; //Total events popped.
+
+public:
+    EventRing() : head(0), tail(0) {}
+
+    bool push(const SimulationEvent& event) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if(h - tail.load(std::memory_order_acquire) == EVENT_RING_CAPACITY) {
+            return false;
+        }
+        events[h & (EVENT_RING_CAPACITY - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void popInto(std::vector<SimulationEvent>& batch) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for(; t != h; t++) {
+            batch.push_back(events[t & (EVENT_RING_CAPACITY - 1)]);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    size_t pushedCount() const {return head.load(std::memory_order_acquire);}
+    bool empty() const {return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);}
+};
+
+/*
+ * Carries events from the simulation's worker threads to the delegate.
+ * Each worker thread pushes into its own lock-free ring (registered on its first push), and a single consumer thread
+ * drains all rings in batches and delivers them, either through simulation:didReceiveEvents:count: or,
+ * for delegates that only implement the per-event methods, one call per event. Either way the delegate
+ * is only ever called from the consumer thread, never concurrently, and never from inside the tick loop.
+ *
+ * Subscriptions are resolved once when the pipeline is created. Events from one worker arrive in order;
+ * events from different workers may interleave. A worker whose ring is full drops the event instead of waiting
+ * for the consumer, so a slow delegate never slows the simulation down; droppedEventCount() says how many were lost.
+ * The consumer sleeps on a condition while every ring is empty; a push only takes the lock to wake it.
+ */
+class EventPipeline {
+    Simulation* simulation;
+    NSObject* delegate;
+    BOOL batched;
+    BOOL pickups;
+    BOOL pheromones;
+    BOOL ticks;
+
+    uint64_t serial; //Distinguishes this pipeline from earlier ones in threads' cached rings.
+    std::mutex ringLock; //Guards rings against registration while the consumer walks it.
+    std::vector<std::unique_ptr<EventRing>> rings;
+
+    std::thread consumer;
+    std::atomic<bool> running;
+    std::atomic<bool> sleeping; //Consumer is (about to be) waiting on wake.
+    std::mutex wakeLock;
+    std::condition_variable wake; //Signaled by producers when the consumer is sleeping, and on shutdown.
+    std::atomic<size_t> delivered;
+    std::atomic<uint64_t> droppedEvents;
+    std::mutex deliveredLock;
+    std::condition_variable deliveredChanged; //Signaled by the consumer after each batch, for flush().
+
+    EventRing* ringForCurrentThread();
+    bool pending();
+    void wakeConsumer();
+    void consume();
+    void deliver(const std::vector<SimulationEvent>& batch);
+
+public:
+    EventPipeline(Simulation* _simulation, NSObject* _delegate);
+    ~EventPipeline();
+
+    BOOL wantsPickups() const {return pickups;}
+    BOOL wantsPheromones() const {return pheromones;}
+    BOOL wantsTicks() const {return ticks;}
+    BOOL wantsAny() const {return pickups || pheromones || ticks;}
+
+    void push(const SimulationEvent& event);
+    void flush(); //Returns once everything pushed so far has been delivered.
+    uint64_t droppedEventCount() const {return droppedEvents.load(std::memory_order_relaxed);}
+};
+
+#endif
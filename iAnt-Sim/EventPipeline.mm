@@ -0,0 +1,164 @@
+#import "EventPipeline.h"
+#import "Pheromone.h"
+#import "Simulation.h"
+#import "Tag.h"
+
+using namespace std;
+
+static atomic<uint64_t> nextPipelineSerial(1);
+static __thread EventRing* threadEventRing = NULL;
+static __thread uint64_t threadEventRingSerial = 0;
+
+EventPipeline::EventPipeline(Simulation* _simulation, NSObject* _delegate) : simulation(_simulation), delegate(_delegate), running(true), sleeping(false), delivered(0), droppedEvents(0) {
+    batched = delegate && [delegate respondsToSelector:@selector(simulation:didReceiveEvents:count:)];
+    pickups = batched || (delegate && [delegate respondsToSelector:@selector(simulation:didPickupTag:atTick:)]);
+    pheromones = batched || (delegate && [delegate respondsToSelector:@selector(simulation:didPlacePheromone:atTick:)]);
+    ticks = batched || (delegate && [delegate respondsToSelector:@selector(simulation:didFinishTick:)]);
+    serial = nextPipelineSerial++;
+    if(wantsAny()) {
+        consumer = thread(&EventPipeline::consume, this);
+    }
+}
+
+EventPipeline::~EventPipeline() {
+    running = false;
+    {
+        lock_guard<mutex> lock(wakeLock);
+        sleeping = false;
+    }
+    wake.notify_one();
+    if(consumer.joinable()) {
+        consumer.join();
+    }
+}
+
+EventRing* EventPipeline::ringForCurrentThread() {
+    if(threadEventRingSerial != serial) {
+        lock_guard<mutex> lock(ringLock);
+        rings.push_back(unique_ptr<EventRing>(new EventRing()));
+        threadEventRing = rings.back().get();
+        threadEventRingSerial = serial;
+    }
+    return threadEventRing;
+}
+
+void EventPipeline::push(const SimulationEvent& event) {
+    EventRing* ring = ringForCurrentThread();
+    if(!ring->push(event)) {
+        if(event.object) {
+            CFBridgingRelease(event.object);
+        }
+        droppedEvents.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    //Pairs with the store to sleeping in consume(): either it sees this event or we see it sleeping.
+    atomic_thread_fence(memory_order_seq_cst);
+    if(sleeping.load(memory_order_relaxed)) {
+        wakeConsumer();
+    }
+}
+
+void EventPipeline::wakeConsumer() {
+    {
+        lock_guard<mutex> lock(wakeLock);
+        sleeping = false;
+    }
+    wake.notify_one();
+}
+
+bool EventPipeline::pending() {
+    lock_guard<mutex> lock(ringLock);
+    for(auto& ring : rings) {
+        if(!ring->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventPipeline::flush() {
+    if(!consumer.joinable()) {
+        return;
+    }
+    size_t pushed = 0;
+    {
+        lock_guard<mutex> lock(ringLock);
+        for(auto& ring : rings) {
+            pushed += ring->pushedCount();
+        }
+    }
+    unique_lock<mutex> lock(deliveredLock);
+    deliveredChanged.wait(lock, [&] {return delivered.load(memory_order_acquire) >= pushed;});
+}
+
+/*
+ * Consumer thread: drains every ring into one batch and delivers it, until stopped and empty.
+ */
+void EventPipeline::consume() {
+    vector<SimulationEvent> batch;
+    batch.reserve(EVENT_RING_CAPACITY);
+    while(true) {
+        batch.clear();
+        BOOL stopping = !running.load(memory_order_acquire); //Read before draining so nothing pushed earlier is missed.
+        {
+            lock_guard<mutex> lock(ringLock);
+            for(auto& ring : rings) {
+                ring->popInto(batch);
+            }
+        }
+        if(batch.empty()) {
+            if(stopping) {
+                return;
+            }
+            unique_lock<mutex> lock(wakeLock);
+            sleeping.store(true, memory_order_seq_cst);
+            if(!pending() && running.load(memory_order_acquire)) {
+                wake.wait(lock, [&] {return !sleeping.load(memory_order_relaxed);});
+            }
+            sleeping = false;
+            continue;
+        }
+        deliver(batch);
+        {
+            lock_guard<mutex> lock(deliveredLock);
+            delivered.fetch_add(batch.size(), memory_order_release);
+        }
+        deliveredChanged.notify_all();
+    }
+}
+
+void EventPipeline::deliver(const vector<SimulationEvent>& batch) {
+    @autoreleasepool {
+        if(batched) {
+            [delegate simulation:simulation didReceiveEvents:batch.data() count:(int)batch.size()];
+        }
+
+        for(const SimulationEvent& event : batch) {
+            if(batched) {
+                if(event.object) {
+                    CFBridgingRelease(event.object);
+                }
+                continue;
+            }
+
+            switch(event.type) {
+                case SimulationEventPickup:
+                    if(event.object) {
+                        [delegate simulation:simulation didPickupTag:(Tag*)CFBridgingRelease(event.object) atTick:event.tick];
+                    }
+                    break;
+                case SimulationEventPheromone:
+                    if(event.object) {
+                        [delegate simulation:simulation didPlacePheromone:(Pheromone*)CFBridgingRelease(event.object) atTick:event.tick];
+                    }
+                    break;
+                case SimulationEventTick:
+                    if([delegate respondsToSelector:@selector(simulation:didFinishTick:)]) {
+                        [delegate simulation:simulation didFinishTick:event.tick];
+                    }
+                    break;
+            }
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#import <Foundation/Foundation.h>
+#import "Team.h"
+#import "Utilities.h"
+
+/*
+ * Remembers fitness samples of genomes that have already been simulated.
+ * Entries are keyed by a hash of the genome combined with a hash of the simulation
+ * configuration, so samples are only reused when they were measured under the same conditions.
+ */
+@interface FitnessCache : NSObject
+
+-(id) initWithConfigurationHash:(uint64_t)_configurationHash;
+-(id) initWithFile:(NSString*)filePath andConfigurationHash:(uint64_t)_configurationHash;
+
+-(int) samplesForGenome:(const float*)genome meanFitness:(float*)meanFitness meanTimeToCompleteCollection:(float*)meanTime;
+-(void) addSamples:(int)samples withFitnessSum:(float)fitnessSum timeToCompleteCollection:(int)time forGenome:(const float*)genome;
+-(void) writeToFile:(NSString*)filePath;
+
+@property (readonly, nonatomic) uint64_t configurationHash;
+@property (readonly, nonatomic) int hits; //Number of lookups that found at least one sample.
+@property (readonly, nonatomic) int misses;
+
+@end
@@ -0,0 +1,113 @@
+#import "FitnessCache.h"
+#import <unordered_map>
+
+using namespace std;
+
+typedef struct {
+    float genome[TEAM_PARAMETER_COUNT];
+    int samples;
+    double meanFitness; //Running mean of the per-evaluation fitness.
+    double meanTimeToCompleteCollection; //Running mean of Team's timeToCompleteCollection (0 unless it was measured).
+} FitnessCacheEntry;
+
+@implementation FitnessCache {
+    unordered_map<uint64_t, FitnessCacheEntry> entries;
+}
+
+@synthesize configurationHash, hits, misses;
+
+-(id) initWithConfigurationHash:(uint64_t)_configurationHash {
+    if(self = [super init]) {
+        configurationHash = _configurationHash;
+        hits = misses = 0;
+    }
+    return self;
+}
+
+/*
+ * Loads entries previously saved with writeToFile:.
+ * Entries recorded under a different configuration are ignored.
+ */
+-(id) initWithFile:(NSString*)filePath andConfigurationHash:(uint64_t)_configurationHash {
+    if(self = [self initWithConfigurationHash:_configurationHash]) {
+        NSDictionary* contents = [NSDictionary dictionaryWithContentsOfFile:filePath];
+        NSString* configuration = [NSString stringWithFormat:@"%016llx", configurationHash];
+        if(contents && [[contents objectForKey:@"configurationHash"] isEqualToString:configuration]) {
+            for(NSDictionary* record in [contents objectForKey:@"entries"]) {
+                NSArray* genome = [record objectForKey:@"genome"];
+                if([genome count] != TEAM_PARAMETER_COUNT) {
+                    continue;
+                }
+                FitnessCacheEntry entry;
+                for(int g = 0; g < TEAM_PARAMETER_COUNT; g++) {
+                    entry.genome[g] = [[genome objectAtIndex:g] floatValue];
+                }
+                entry.samples = [[record objectForKey:@"samples"] intValue];
+                entry.meanFitness = [[record objectForKey:@"meanFitness"] doubleValue];
+                entry.meanTimeToCompleteCollection = [[record objectForKey:@"meanTimeToCompleteCollection"] doubleValue];
+                entries[hashBytes(entry.genome, sizeof(entry.genome), configurationHash)] = entry;
+            }
+        }
+    }
+    return self;
+}
+
+/*
+ * Returns the number of samples recorded for genome and stores their mean fitness and time to complete collection.
+ * Returns 0 (and leaves both untouched) for unseen genomes.
+ */
+-(int) samplesForGenome:(const float*)genome meanFitness:(float*)meanFitness meanTimeToCompleteCollection:(float*)meanTime {
+    auto it = entries.find(hashBytes(genome, TEAM_PARAMETER_COUNT * sizeof(float), configurationHash));
+    if(it == entries.end() || memcmp(it->second.genome, genome, sizeof(it->second.genome))) {
+        misses++;
+        return 0;
+    }
+    hits++;
+    *meanFitness = it->second.meanFitness;
+    *meanTime = it->second.meanTimeToCompleteCollection;
+    return it->second.samples;
+}
+
+/*
+ * Folds a batch of new samples into the running means for genome.
+ * time is the team's timeToCompleteCollection after the batch, which counts for each of its samples.
+ */
+-(void) addSamples:(int)samples withFitnessSum:(float)fitnessSum timeToCompleteCollection:(int)time forGenome:(const float*)genome {
+    if(samples <= 0) {
+        return;
+    }
+
+    FitnessCacheEntry& entry = entries[hashBytes(genome, TEAM_PARAMETER_COUNT * sizeof(float), configurationHash)];
+    if(entry.samples && memcmp(entry.genome, genome, sizeof(entry.genome))) {
+        entry.samples = 0; //Hash collision; the newer genome wins.
+    }
+    if(!entry.samples) {
+        memcpy(entry.genome, genome, sizeof(entry.genome));
+        entry.meanFitness = 0.;
+        entry.meanTimeToCompleteCollection = 0.;
+    }
+
+    int total = entry.samples + samples;
+    entry.meanFitness += ((fitnessSum / samples) - entry.meanFitness) * samples / total;
+    entry.meanTimeToCompleteCollection += (time - entry.meanTimeToCompleteCollection) * samples / total;
+    entry.samples = total;
+}
+
+-(void) writeToFile:(NSString*)filePath {
+    NSMutableArray* records = [[NSMutableArray alloc] initWithCapacity:entries.size()];
+    for(auto& it : entries) {
+        NSMutableArray* genome = [[NSMutableArray alloc] initWithCapacity:TEAM_PARAMETER_COUNT];
+        for(int g = 0; g < TEAM_PARAMETER_COUNT; g++) {
+            [genome addObject:@(it.second.genome[g])];
+        }
+        [records addObject:@{@"genome" : genome,
+                             @"samples" : @(it.second.samples),
+                             @"meanFitness" : @(it.second.meanFitness),
+                             @"meanTimeToCompleteCollection" : @(it.second.meanTimeToCompleteCollection)}];
+    }
+
+    [@{@"configurationHash" : [NSString stringWithFormat:@"%016llx", configurationHash],
+       @"entries" : records} writeToFile:filePath atomically:YES];
+}
+
+@end
@@ -0,0 +1,23 @@
+#import <Foundation/Foundation.h>
+#import "Team.h"
+#import "Utilities.h"
+
+/*
+ * Random forest regression from genomes to per-evaluation fitness, trained on the genomes simulated so far.
+ * Used to screen out children that are predicted to be weak before paying for their simulation.
+ * Only the most recent capacity samples are kept, so the model follows the population as it moves.
+ */
+@interface FitnessSurrogate : NSObject
+
+-(id) initWithCapacity:(int)_capacity;
+
+-(void) addGenome:(const float*)genome withFitness:(float)fitness;
+-(BOOL) train;
+-(float) predictFitnessForGenome:(const float*)genome;
+
+@property (readonly, nonatomic) int capacity;
+@property (readonly, nonatomic) int sampleCount;
+@property (readonly, nonatomic) BOOL trained;
+@property (nonatomic) int screenedCount; //Children given a predicted fitness instead of being simulated.
+
+@end
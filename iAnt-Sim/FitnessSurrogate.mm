@@ -0,0 +1,65 @@
+#import "FitnessSurrogate.h"
+
+using namespace std;
+
+#define SURROGATE_MIN_SAMPLES 32 //Fewer samples than this and predictions are not worth trusting.
+
+@implementation FitnessSurrogate {
+    vector<float> genomes; //capacity x TEAM_PARAMETER_COUNT, used as a ring buffer.
+    vector<float> fitnesses;
+    int nextSample;
+    CvRTrees forest;
+}
+
+@synthesize capacity, sampleCount, trained, screenedCount;
+
+-(id) initWithCapacity:(int)_capacity {
+    if(self = [super init]) {
+        capacity = MAX(_capacity, SURROGATE_MIN_SAMPLES);
+        genomes.resize(capacity * TEAM_PARAMETER_COUNT);
+        fitnesses.resize(capacity);
+        nextSample = sampleCount = screenedCount = 0;
+        trained = NO;
+    }
+    return self;
+}
+
+/*
+ * Records a simulated sample, overwriting the oldest one once capacity is reached.
+ */
+-(void) addGenome:(const float*)genome withFitness:(float)fitness {
+    memcpy(&genomes[nextSample * TEAM_PARAMETER_COUNT], genome, TEAM_PARAMETER_COUNT * sizeof(float));
+    fitnesses[nextSample] = fitness;
+    nextSample = (nextSample + 1) % capacity;
+    sampleCount = MIN(sampleCount + 1, capacity);
+}
+
+/*
+ * Refits the forest to the recorded samples.
+ * Returns NO (and stays untrained) until there are enough samples.
+ */
+-(BOOL) train {
+    if(sampleCount < SURROGATE_MIN_SAMPLES) {
+        return trained = NO;
+    }
+
+    cv::Mat samples(sampleCount, TEAM_PARAMETER_COUNT, CV_32F, genomes.data());
+    cv::Mat responses(sampleCount, 1, CV_32F, fitnesses.data());
+
+    //All variables, including the response, are ordered, which makes this a regression forest.
+    cv::Mat varType(TEAM_PARAMETER_COUNT + 1, 1, CV_8U, cv::Scalar(CV_VAR_ORDERED));
+
+    CvRTParams params(8, 4, 0.f, false, 16, 0, false, 0, 50, 0.01f, CV_TERMCRIT_ITER);
+    trained = forest.train(samples, CV_ROW_SAMPLE, responses, cv::Mat(), cv::Mat(), varType, cv::Mat(), params);
+    return trained;
+}
+
+/*
+ * Returns the predicted per-evaluation fitness of genome; only meaningful once trained.
+ */
+-(float) predictFitnessForGenome:(const float*)genome {
+    cv::Mat sample(1, TEAM_PARAMETER_COUNT, CV_32F, (void*)genome);
+    return forest.predict(sample);
+}
+
+@end
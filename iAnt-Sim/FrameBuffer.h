@@ -0,0 +1,98 @@
+#import <Foundation/Foundation.h>
+
+#ifdef __cplusplus
+
+#import <atomic>
+#import <vector>
+
+/*
+ * Compact copy of what the view draws for one tick, independent of the live simulation objects.
+ */
+struct FrameRobot {
+    int32_t x;
+    int32_t y;
+    uint8_t status;
+    uint8_t informed;
+};
+
+struct FramePheromone {
+    int32_t x;
+    int32_t y;
+    float weight; //Decayed to the frame's tick.
+};
+
+struct FrameCluster {
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+struct SimulationFrame {
+    uint64_t sequence; //Increases by one per published frame.
+    int tick;
+    float fitness; //Tags collected so far by the team being evaluated.
+    int width;
+    int height;
+    std::vector<FrameRobot> robots;
+    std::vector<uint64_t> explored; //One bit per cell, row-major, set once a robot has searched the cell.
+    std::vector<NSPoint> tags; //Tags not yet picked up.
+    std::vector<FramePheromone> pheromones;
+    std::vector<FrameCluster> clusters;
+
+    //Producer bookkeeping: explored is cleared once per evaluation and otherwise only extended.
+    uint64_t exploredEvaluation; //Evaluation explored was built for.
+    size_t exploredCount; //Entries of the evaluation's explored-cell log already set in explored.
+};
+
+#define FRAME_FRESH 4 //Flag on FrameBuffer's middle index marking a frame the consumer has not taken yet.
+
+/*
+ * Lock-free triple buffer handing frames from the simulation thread to a display consumer.
+ * The producer fills back() and publishes it; the consumer takes the newest published frame with acquire().
+ * Neither side ever waits, a slow consumer just skips frames, and a frame is never written while it is being read.
+ */
+class FrameBuffer {
+    SimulationFrame frames[3];
+    int back; //Owned by the producer.
+    int front; //Owned by the consumer.
+    std::atomic<int> middle;
+    uint64_t sequence;
+
+public:
+    FrameBuffer() : back(0), front(2), middle(1), sequence(0) {
+        for(SimulationFrame& frame : frames) {
+            frame.exploredEvaluation = 0;
+            frame.exploredCount = 0;
+        }
+    }
+
+    SimulationFrame& backFrame() {return frames[back];}
+
+    /*
+     * Whether the consumer has taken the last published frame, i.e. whether publishing now would not just replace it unseen.
+     */
+    bool wantsFrame() const {return !(middle.load(std::memory_order_acquire) & FRAME_FRESH);}
+
+    /*
+     * Makes the back frame the newest one available to the consumer.
+     */
+    void publish() {
+        frames[back].sequence = ++sequence;
+        back = middle.exchange(back | FRAME_FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    /*
+     * Returns the newest published frame, or NULL if nothing was published since the last call.
+     * The frame stays valid and unchanged until the next call.
+     */
+    const SimulationFrame* acquire() {
+        if(!(middle.load(std::memory_order_acquire) & FRAME_FRESH)) {
+            return NULL;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        return &frames[front];
+    }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#import <Foundation/Foundation.h>
+#import "FrameBuffer.h"
+
+#ifdef __cplusplus
+
+#import <string>
+#import <vector>
+
+#define FRAME_STREAM_KEYFRAME 0
+#define FRAME_STREAM_DELTA 1
+
+/*
+ * Streams frames to any number of clients over a Unix domain socket ("unix:/path") or TCP on loopback ("tcp:port"),
+ * so headless runs can be watched from elsewhere (e.g. through an SSH tunnel).
+ *
+ * Each message is a 4-byte little-endian length followed by a zlib-compressed frame:
+ * kind (keyframe or delta) | sequence | tick | fitness (4 raw bytes) | width | height |
+ * robots: count, (x, y, status, informed)* | explored: words as 8 raw bytes each | pheromones: count, (x, y, weight)*.
+ * In a delta, robot positions are differences from the previous frame, and robot flags and explored words are XORed with it;
+ * a client only gets deltas against the frame it last received, otherwise a keyframe.
+ * Integers are varints, signed ones zigzag-encoded (see Trace.h).
+ *
+ * Sockets never block: a client that hasn't drained its previous message misses frames instead of stalling
+ * the caller, and catches up with a keyframe. Not thread-safe; use it from one queue.
+ */
+class FrameServer {
+    struct Client {
+        int socket;
+        std::vector<uint8_t> pending; //Unsent tail of the last message.
+        uint64_t lastSequence; //Frame the client will have once pending is sent; 0 if none.
+    };
+
+    int listenSocket;
+    std::string unixPath; //Removed again on close.
+    std::vector<Client> clients;
+
+    SimulationFrame base; //Last frame sent, the reference for deltas.
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> keyframe;
+    std::vector<uint8_t> delta;
+
+    bool encode(const SimulationFrame& frame, const SimulationFrame* reference, std::vector<uint8_t>& message);
+    bool flushClient(Client& client);
+
+public:
+    FrameServer() : listenSocket(-1), sentFrames(0), droppedFrames(0) {}
+    ~FrameServer() {close();}
+
+    uint64_t sentFrames; //Summed over clients.
+    uint64_t droppedFrames;
+
+    bool open(const char* address);
+    void close();
+    int socket() const {return listenSocket;}
+
+    void acceptClients();
+    void send(const SimulationFrame& frame);
+    void flush();
+};
+
+#endif
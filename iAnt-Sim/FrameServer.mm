@@ -0,0 +1,217 @@
+#import "FrameServer.h"
+#import "Trace.h"
+#import <arpa/inet.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <unistd.h>
+
+using namespace std;
+
+#define FRAME_SERVER_BACKLOG 8
+
+static void setNonBlocking(int socket) {
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+/*
+ * Starts listening on address; returns false if it is malformed or can't be bound.
+ */
+bool FrameServer::open(const char* address) {
+    close();
+    string spec(address);
+
+    if(spec.compare(0, 5, "unix:") == 0) {
+        struct sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        unixPath = spec.substr(5);
+        if(unixPath.empty() || unixPath.size() >= sizeof(local.sun_path)) {
+            return false;
+        }
+        strncpy(local.sun_path, unixPath.c_str(), sizeof(local.sun_path) - 1);
+        unlink(unixPath.c_str());
+        listenSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listenSocket < 0 || ::bind(listenSocket, (struct sockaddr*)&local, sizeof(local)) < 0) {
+            close();
+            return false;
+        }
+    }
+    else if(spec.compare(0, 4, "tcp:") == 0) {
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        local.sin_port = htons((uint16_t)atoi(spec.c_str() + 4));
+        listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        if(listenSocket >= 0) {
+            setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        }
+        if(listenSocket < 0 || ::bind(listenSocket, (struct sockaddr*)&local, sizeof(local)) < 0) {
+            close();
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+
+    if(listen(listenSocket, FRAME_SERVER_BACKLOG) < 0) {
+        close();
+        return false;
+    }
+    setNonBlocking(listenSocket);
+    return true;
+}
+
+void FrameServer::close() {
+    for(Client& client : clients) {
+        ::close(client.socket);
+    }
+    clients.clear();
+    if(listenSocket >= 0) {
+        ::close(listenSocket);
+        listenSocket = -1;
+    }
+    if(!unixPath.empty()) {
+        unlink(unixPath.c_str());
+        unixPath.clear();
+    }
+    base.sequence = 0;
+}
+
+/*
+ * Takes every pending connection; new clients start with a keyframe.
+ */
+void FrameServer::acceptClients() {
+    int socket;
+    while((socket = accept(listenSocket, NULL, NULL)) >= 0) {
+        setNonBlocking(socket);
+        Client client = {socket, vector<uint8_t>(), 0};
+        clients.push_back(client);
+    }
+}
+
+/*
+ * Writes as much of the client's pending bytes as the socket takes.
+ * Returns false if the client is gone.
+ */
+bool FrameServer::flushClient(Client& client) {
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+    while(!client.pending.empty()) {
+        ssize_t written = ::send(client.socket, client.pending.data(), client.pending.size(), flags);
+        if(written < 0) {
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+        }
+        client.pending.erase(client.pending.begin(), client.pending.begin() + written);
+    }
+    return true;
+}
+
+void FrameServer::flush() {
+    for(size_t i = 0; i < clients.size(); ) {
+        if(flushClient(clients[i])) {
+            i++;
+        }
+        else {
+            ::close(clients[i].socket);
+            clients.erase(clients.begin() + i);
+        }
+    }
+}
+
+/*
+ * Encodes frame as a complete message, as a delta against reference if one is given.
+ * Returns false, leaving message empty, if it can't be compressed.
+ */
+bool FrameServer::encode(const SimulationFrame& frame, const SimulationFrame* reference, vector<uint8_t>& message) {
+    raw.clear();
+    raw.push_back(reference ? FRAME_STREAM_DELTA : FRAME_STREAM_KEYFRAME);
+    tracePutVarint(raw, (uint32_t)frame.sequence);
+    tracePutVarint(raw, frame.tick);
+    uint32_t fitness;
+    memcpy(&fitness, &frame.fitness, sizeof(fitness));
+    tracePutFixed(raw, fitness, 4);
+    tracePutVarint(raw, frame.width);
+    tracePutVarint(raw, frame.height);
+
+    //Deltas are only taken against a frame of the same shape.
+    tracePutVarint(raw, (uint32_t)frame.robots.size());
+    for(size_t i = 0; i < frame.robots.size(); i++) {
+        FrameRobot previous = reference ? reference->robots[i] : FrameRobot();
+        tracePutSigned(raw, frame.robots[i].x - previous.x);
+        tracePutSigned(raw, frame.robots[i].y - previous.y);
+        tracePutVarint(raw, frame.robots[i].status ^ previous.status);
+        tracePutVarint(raw, frame.robots[i].informed ^ previous.informed);
+    }
+
+    for(size_t i = 0; i < frame.explored.size(); i++) {
+        tracePutFixed(raw, frame.explored[i] ^ (reference ? reference->explored[i] : 0), 8);
+    }
+
+    tracePutVarint(raw, (uint32_t)frame.pheromones.size());
+    for(const FramePheromone& pheromone : frame.pheromones) {
+        uint32_t weight;
+        memcpy(&weight, &pheromone.weight, sizeof(weight));
+        tracePutSigned(raw, pheromone.x);
+        tracePutSigned(raw, pheromone.y);
+        tracePutFixed(raw, weight, 4);
+    }
+
+    uLongf size = compressBound(raw.size());
+    message.resize(4 + size);
+    if(compress2(message.data() + 4, &size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK) {
+        message.clear();
+        return false;
+    }
+    message.resize(4 + size);
+    for(int i = 0; i < 4; i++) {
+        message[i] = (uint8_t)(size >> (8 * i));
+    }
+    return true;
+}
+
+/*
+ * Queues frame for every client that has finished receiving its last message; the others miss it.
+ */
+void FrameServer::send(const SimulationFrame& frame) {
+    flush();
+    if(clients.empty()) {
+        base.sequence = 0;
+        return;
+    }
+
+    BOOL comparable = base.sequence && (base.width == frame.width) && (base.height == frame.height) && (base.robots.size() == frame.robots.size());
+    keyframe.clear();
+    delta.clear();
+    for(Client& client : clients) {
+        if(!client.pending.empty()) {
+            droppedFrames++;
+            continue;
+        }
+        BOOL useDelta = comparable && (client.lastSequence == base.sequence);
+        vector<uint8_t>& message = useDelta ? delta : keyframe;
+        //A frame that can't be encoded is dropped; the client catches up with a later keyframe.
+        if(message.empty() && !encode(frame, useDelta ? &base : NULL, message)) {
+            droppedFrames++;
+            continue;
+        }
+        client.pending = message;
+        client.lastSequence = frame.sequence;
+        sentFrames++;
+    }
+    flush();
+
+    base = frame;
+}
@@ -14,6 +14,7 @@
 -(id)initWithElitism:(BOOL)_elitism selectionOperator:(int)_selectionOperator crossoverRate:(float)_crossoverRate crossoverOperator:(int)crossoverOperator mutationRate:(float)_mutationRate andMutationOperator:(int)mutationOperator;
 
 -(void)breedPopulation:(NSMutableArray *)population AtGeneration:(int)generation andMaxGeneration:(int)maxGenerations;
+-(void)breedChild:(id)child fromPopulation:(NSArray*)population atGeneration:(int)generation andMaxGeneration:(int)maxGenerations;
 
 @property (nonatomic) float fixedVarianceSigma;
 
@@ -3,8 +3,8 @@
 @interface GA()
 
 //Selection
--(NSMutableArray*)tournamentSelectionOn:(NSMutableArray*)population;
--(NSMutableArray*)rankBasedElististSelectionOn:(NSMutableArray*)population withCutoff:(float)cutoff;
+-(NSMutableArray*)tournamentSelectionOn:(NSArray*)population;
+-(NSMutableArray*)rankBasedElististSelectionOn:(NSArray*)population withCutoff:(float)cutoff;
 
 //Crossover
 -(void)independentAssortmentCrossoverFromParents:(NSMutableArray*)parents toChild:(Team *)child withFirstParentBias:(float)bias;
@@ -19,6 +19,17 @@
 
 @end
 
+/*
+ * Whether a ranks above b. Simulated individuals rank above screened ones, whose fitness is only a prediction,
+ * and otherwise the fitter one ranks higher.
+ */
+static BOOL outranks(id a, id b) {
+    if([a screened] != [b screened]) {
+        return [b screened];
+    }
+    return [a fitness] > [b fitness];
+}
+
 @implementation GA
 
 @synthesize fixedVarianceSigma;
@@ -40,7 +51,7 @@
 /*
  * Tournament selection
  */
--(NSMutableArray*)tournamentSelectionOn:(NSMutableArray*)population {
+-(NSMutableArray*)tournamentSelectionOn:(NSArray*)population {
     NSMutableArray* parents = [[NSMutableArray alloc] init];
     int populationSize = (int)[population count];
     
@@ -52,8 +63,8 @@
             while (candidateOne == candidateTwo) {
                 candidateTwo = [population objectAtIndex:randomInt(populationSize)];
             }
-            //parents[j] gets whichever candidate collected more tags
-            if([candidateOne fitness] > [candidateTwo fitness]) {
+            //parents[j] gets whichever candidate collected more tags (see outranks)
+            if(outranks(candidateOne, candidateTwo)) {
                 [parents addObject:candidateOne];
             }
             else {
@@ -68,7 +79,7 @@
 /*
  * Rank-based elitist selection
  */
--(NSMutableArray*)rankBasedElististSelectionOn:(NSMutableArray*)population withCutoff:(float)cutoff {
+-(NSMutableArray*)rankBasedElististSelectionOn:(NSArray*)population withCutoff:(float)cutoff {
     NSMutableArray* parents = [[NSMutableArray alloc] init];
     int populationSize = (int)[population count];
     
@@ -213,6 +224,93 @@
 }
 
 
+/*
+ * Sets child's parameters by selection, crossover and mutation from population.
+ * population must be sorted by increasing fitness for rank-based selection.
+ */
+-(void) breedChild:(id)child fromPopulation:(NSArray*)population atGeneration:(int)generation andMaxGeneration:(int)maxGenerations {
+    //Selection
+    NSMutableArray* parents;
+    switch (selectionOperator) {
+        case TournamentSelectionId:
+            parents = [self tournamentSelectionOn:population];
+            break;
+        case RankBasedElitistSelectionId:
+            parents = [self rankBasedElististSelectionOn:population withCutoff:0.5];
+            break;
+        default:
+            [NSException raise:@"Invalid GA selection operator" format:@"Selection operator %d does not exist", selectionOperator];
+            break;
+    }
+    
+    //Crossover
+    if(randomFloat(1.0) < crossoverRate) {
+        switch (crossoverOperator){
+            case IndependentAssortmentCrossId:
+                [self independentAssortmentCrossoverFromParents:parents toChild:child withFirstParentBias:0.9];
+                break;
+            case UniformPointCrossId:
+                [self uniformCrossoverFromParents:parents toChild:child];
+                break;
+            case OnePointCrossId:
+                [self onePointCrossoverFromParents:parents toChild:child];
+                break;
+            case TwoPointCross:
+                [self twoPointCrossoverFromParents:parents toChild:child];
+                break;
+            default:
+                [NSException raise:@"Invalid GA crossover operator" format:@"Crossover operator %d does not exist", crossoverOperator];
+                break;
+        }
+    }
+    else {
+        //Otherwise the child will just be a copy of one of the parents
+        id parent = [parents objectAtIndex:randomInt((int)[parents count])];
+        [child setParameters:[parent getParameters]];
+    }
+    
+    //Random mutations
+    NSMutableDictionary* parameters = [child getParameters];
+    for(NSString* key in [parameters allKeys]) {
+        if(randomFloat(1.0) < mutationRate){
+            id parameter = [parameters objectForKey:key];
+            
+            float (^mutateParameter)(float) = ^float(float value) {
+                switch (mutationOperator) {
+                    case ValueDependentVarMutId: {
+                        return [self valueDependentVarianceMutationForParameter:value];
+                    }
+                    case DecreasingVarMutId: {
+                        float maxVariance = 0.1;
+                        float minVariance = 0.005;
+                        return [self decreasingVarianceMutationForParameter:value atGeneration:generation:maxGenerations:maxVariance:minVariance];
+                    }
+                    case FixedVarMutId: {
+                        return [self fixedVarianceMutationForParameter:value :fixedVarianceSigma];
+                    }
+                    default: {
+                        [NSException raise:@"Invalid GA mutation operator" format:@"Mutation operator %d does not exist", crossoverOperator];
+                        return value;
+                    }
+                }
+            };
+            
+            if ([parameter isKindOfClass:[NSNumber class]]) {
+                parameter = @(mutateParameter([parameter floatValue]));
+            }
+            else if ([parameter isKindOfClass:[NSValue class]]) {
+                NSPoint p = [parameter pointValue];
+                parameter = [NSValue valueWithPoint:NSMakePoint(mutateParameter(p.x), mutateParameter(p.y))];
+            }
+            
+            [parameters setObject:parameter forKey:key];
+        }
+    }
+    
+    [child setParameters:parameters];
+}
+
+
 /*
  * 'Breeds' and mutates a popuation.
  * There is a slight tradeoff for readability at the cost of efficiency here,
@@ -224,12 +322,15 @@
     Class populationClass = [[population objectAtIndex:0] class];
     
     if ((populationSize > 1) && [populationClass conformsToProtocol:@protocol(Archivable)]) {
-        //Sort array smallest to largest
+        //Sort array smallest to largest, screened individuals first (see outranks)
         population = (NSMutableArray*)[population sortedArrayUsingComparator:^NSComparisonResult(id objA, id objB) {
+            if([objA screened] != [objB screened]) {
+                return [objA screened] ? NSOrderedAscending : NSOrderedDescending;
+            }
             return [@([objA fitness]) compare:@([objB fitness])];
         }];
         
-        //Elitism
+        //Elitism (a screened individual is only kept if the whole population was screened)
         id bestIndividual;
         if(elitism) {
             bestIndividual = [population objectAtIndex:(populationSize - 1)];
@@ -241,86 +342,7 @@
         for(int i = 0; i < populationSize; i++) {
             id child = [[populationClass alloc] init];
             [children addObject:child];
-            
-            //Selection
-            NSMutableArray* parents;
-            switch (selectionOperator) {
-                case TournamentSelectionId:
-                    parents = [self tournamentSelectionOn:population];
-                    break;
-                case RankBasedElitistSelectionId:
-                    parents = [self rankBasedElististSelectionOn:population withCutoff:0.5];
-                    break;
-                default:
-                    [NSException raise:@"Invalid GA selection operator" format:@"Selection operator %d does not exist", selectionOperator];
-                    break;
-            }
-            
-            //Crossover
-            if(randomFloat(1.0) < crossoverRate) {
-                switch (crossoverOperator){
-                    case IndependentAssortmentCrossId:
-                        [self independentAssortmentCrossoverFromParents:parents toChild:child withFirstParentBias:0.9];
-                        break;
-                    case UniformPointCrossId:
-                        [self uniformCrossoverFromParents:parents toChild:child];
-                        break;
-                    case OnePointCrossId:
-                        [self onePointCrossoverFromParents:parents toChild:child];
-                        break;
-                    case TwoPointCross:
-                        [self twoPointCrossoverFromParents:parents toChild:child];
-                        break;
-                    default:
-                        [NSException raise:@"Invalid GA crossover operator" format:@"Crossover operator %d does not exist", crossoverOperator];
-                        break;
-                }
-            }
-            else {
-                //Otherwise the child will just be a copy of one of the parents
-                id parent = [parents objectAtIndex:randomInt((int)[parents count])];
-                [child setParameters:[parent getParameters]];
-            }
-            
-            //Random mutations
-            NSMutableDictionary* parameters = [child getParameters];
-            for(NSString* key in [parameters allKeys]) {
-                if(randomFloat(1.0) < mutationRate){
-                    id parameter = [parameters objectForKey:key];
-                    
-                    float (^mutateParameter)(float) = ^float(float value) {
-                        switch (mutationOperator) {
-                            case ValueDependentVarMutId: {
-                                return [self valueDependentVarianceMutationForParameter:value];
-                            }
-                            case DecreasingVarMutId: {
-                                float maxVariance = 0.1;
-                                float minVariance = 0.005;
-                                return [self decreasingVarianceMutationForParameter:value atGeneration:generation:maxGenerations:maxVariance:minVariance];
-                            }
-                            case FixedVarMutId: {
-                                return [self fixedVarianceMutationForParameter:value :fixedVarianceSigma];
-                            }
-                            default: {
-                                [NSException raise:@"Invalid GA mutation operator" format:@"Mutation operator %d does not exist", crossoverOperator];
-                                return value;
-                            }
-                        }
-                    };
-                    
-                    if ([parameter isKindOfClass:[NSNumber class]]) {
-                        parameter = @(mutateParameter([parameter floatValue]));
-                    }
-                    else if ([parameter isKindOfClass:[NSValue class]]) {
-                        NSPoint p = [parameter pointValue];
-                        parameter = [NSValue valueWithPoint:NSMakePoint(mutateParameter(p.x), mutateParameter(p.y))];
-                    }
-                    
-                    [parameters setObject:parameter forKey:key];
-                }
-            }
-            
-            [child setParameters:parameters];
+            [self breedChild:child fromPopulation:population atGeneration:generation andMaxGeneration:maxGenerations];
         }
         
         //Set the children to be the new population for the next generation.
@@ -0,0 +1,82 @@
+#import "Cell.h"
+#import "SensorError.h"
+#import "Simulation.h"
+#import "Team.h"
+
+using namespace std;
+
+#define GOLDEN_EVALUATIONS 30 //Same as GoldenTrace's default.
+
+/*
+ * Records the baseline scenarios of a golden suite with the engine from before the optimizations (see golden.sh):
+ *
+ *   golden-baseline <Scenarios.plist> <recording directory> <revision>
+ *
+ * It is compiled against that revision's sources, so it only uses what they already had. That engine can't write traces,
+ * so its recordings hold fitness samples only; GoldenTrace compares those bit for bit and by distribution.
+ */
+int main(int argc, const char* argv[]) {
+    @autoreleasepool {
+        if(argc != 4) {
+            fprintf(stderr, "usage: %s scenarios.plist directory revision\n", argv[0]);
+            return 2;
+        }
+        
+        NSArray* definitions = [NSArray arrayWithContentsOfFile:@(argv[1])];
+        if(!definitions) {
+            fprintf(stderr, "Could not read %s\n", argv[1]);
+            return 2;
+        }
+        
+        int failures = 0;
+        for(NSDictionary* definition in definitions) {
+            if(![[definition objectForKey:@"baseline"] boolValue]) {
+                continue;
+            }
+            NSString* name = [definition objectForKey:@"name"];
+            unsigned seed = [[definition objectForKey:@"seed"] unsignedIntValue];
+            
+            Simulation* simulation = [[Simulation alloc] init];
+            NSMutableDictionary* parameters = [simulation getParameters];
+            [parameters addEntriesFromDictionary:[definition objectForKey:@"simulation"]];
+            [simulation setParameters:parameters];
+            [simulation setPostEvaluations:GOLDEN_EVALUATIONS];
+            [simulation setError:[simulation observedError] ? [[SensorError alloc] initObserved] : [[SensorError alloc] init]];
+            
+            Team* team = [[Team alloc] init];
+            [team setParameters:[[definition objectForKey:@"team"] mutableCopy]];
+            
+            //The old evaluateTeam:onGrid: evaluates averageTeam rather than the team it is passed.
+            [simulation setValue:team forKey:@"averageTeam"];
+            
+            vector<vector<Cell*>> grid([simulation gridSize].height);
+            for(vector<Cell*>& row : grid) {
+                row.resize([simulation gridSize].width);
+                for(Cell*& cell : row) {
+                    cell = [[Cell alloc] init];
+                }
+            }
+            
+            srandom(seed);
+            NSDictionary* results = [simulation evaluateTeam:team onGrid:grid];
+            
+            NSDictionary* scenario = @{@"simulation":parameters,
+                                       @"team":[team getParameters],
+                                       @"seed":@(seed),
+                                       @"evaluations":@(GOLDEN_EVALUATIONS),
+                                       @"fitness":[results objectForKey:@"fitness"],
+                                       @"traced":@NO,
+                                       @"engine":@(argv[3])};
+            NSString* path = [@(argv[2]) stringByAppendingPathComponent:name];
+            [[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:nil];
+            if([scenario writeToFile:[path stringByAppendingPathComponent:@"scenario.plist"] atomically:YES]) {
+                printf("%s: recorded\n", [name UTF8String]);
+            }
+            else {
+                printf("%s: FAILED (could not save the recording)\n", [name UTF8String]);
+                failures++;
+            }
+        }
+        return failures ? 1 : 0;
+    }
+}
@@ -0,0 +1,35 @@
+#import "GoldenTrace.h"
+
+/*
+ * Command-line driver for the golden scenarios (see golden.sh):
+ *
+ *   golden-verify <Scenarios.plist> <recording directory>
+ *
+ * Records the scenarios that have no recording yet, verifies the rest, prints every outcome
+ * and exits with 1 if any scenario failed.
+ */
+int main(int argc, const char* argv[]) {
+    @autoreleasepool {
+        if(argc != 3) {
+            fprintf(stderr, "usage: %s scenarios.plist directory\n", argv[0]);
+            return 2;
+        }
+        
+        GoldenTrace* harness = [[GoldenTrace alloc] initWithDirectory:@(argv[2])];
+        NSDictionary* outcomes = [harness runScenariosFromFile:@(argv[1])];
+        if(!outcomes) {
+            fprintf(stderr, "Could not read %s\n", argv[1]);
+            return 2;
+        }
+        
+        int failures = 0;
+        for(NSString* name in [[outcomes allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+            NSString* outcome = [outcomes objectForKey:name];
+            printf("%s: %s\n", [name UTF8String], [outcome UTF8String]);
+            if([outcome hasPrefix:@"FAILED"]) {
+                failures++;
+            }
+        }
+        return failures ? 1 : 0;
+    }
+}
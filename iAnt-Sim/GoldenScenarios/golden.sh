@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Golden-scenario checks for iAnt-Sim (see GoldenTrace.h); needs Xcode's command line tools.
+#
+#   golden.sh record-baseline [revision]
+#       Records the scenarios of Scenarios.plist marked baseline with the engine at revision
+#       (by default the one from before the optimizations, GOLDEN_BASELINE_REVISION).
+#   golden.sh [verify]
+#       Builds the working tree, records the other scenarios that have no recording yet and verifies everything
+#       that has one. Exits with a non-zero status if any scenario FAILED.
+#
+# Recordings are written next to Scenarios.plist, one directory per scenario, and are meant to be committed.
+
+set -e
+
+GOLDEN_BASELINE_REVISION=cf6f1f1ec71058fb97889751d1a563b877c3a1a8 #Engine before the optimization series.
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(cd "$here/../.." && pwd)
+work=$(mktemp -d "${TMPDIR:-/tmp}/golden.XXXXXX")
+trap 'rm -rf "$work"; git -C "$root" worktree prune' EXIT
+
+# build_tool <source root> <driver source> <tool>
+# Builds the library in source root and links the driver against it.
+build_tool() {
+    build="$work/build-$(basename "$3")"
+    xcodebuild -project "$1/iAnt-Sim.xcodeproj" -target iAnt-Sim -configuration Release SYMROOT="$build" >/dev/null
+    clang++ -std=gnu++0x -stdlib=libc++ -fobjc-arc -x objective-c++ -include "$1/iAnt-Sim/iAnt-Sim-Prefix.pch" \
+        -I"$1/iAnt-Sim" -I"$1/iAnt-Sim/OpenCV/include" "$2" \
+        -L"$build/Release" -liAnt-Sim -L"$1/iAnt-Sim/OpenCV/lib" -lopencv_ml -lopencv_core -lzlib \
+        -framework Cocoa -o "$3"
+}
+
+case "${1:-verify}" in
+    record-baseline)
+        revision=${2:-$GOLDEN_BASELINE_REVISION}
+        git -C "$root" worktree add --detach "$work/baseline" "$revision" >/dev/null
+        build_tool "$work/baseline" "$here/BaselineRecorder.mm" "$work/golden-baseline"
+        "$work/golden-baseline" "$here/Scenarios.plist" "$here" "$revision"
+        ;;
+    verify)
+        build_tool "$root" "$here/GoldenVerify.mm" "$work/golden-verify"
+        "$work/golden-verify" "$here/Scenarios.plist" "$here"
+        ;;
+    *)
+        echo "usage: $0 [verify | record-baseline [revision]]" >&2
+        exit 2
+        ;;
+esac
@@ -0,0 +1,51 @@
+#import <Foundation/Foundation.h>
+
+@class Team;
+
+/*
+ * Outcome of checking the current engine against a recorded scenario.
+ * The p-values are for the hypothesis that the recorded and new fitness samples come from the same distribution
+ * (two-sample Kolmogorov-Smirnov) or have the same mean (Welch's t-test).
+ */
+typedef struct {
+    BOOL passed; //Bit-exact, or neither test rejected at the harness's significance level.
+    BOOL bitExact; //Same fitness and the same trace, tick for tick.
+    int divergentEvaluation; //First evaluation that differs, -1 if none.
+    int divergentTick; //First tick of that evaluation that differs, -1 if only the fitness does.
+    double ksStatistic;
+    double ksPValue;
+    double welchStatistic;
+    double welchPValue;
+} GoldenVerdict;
+
+/*
+ * Golden-trace harness for changes that should not alter behavior (e.g. faster state transitions, walks,
+ * pheromone lookups or random number generation).
+ *
+ * Recording a scenario evaluates a team under fixed simulation parameters and a fixed seed, single-threaded,
+ * and stores the parameters, seed, per-evaluation fitness and a trace of every evaluation (see Trace.h)
+ * in directory/name. Verifying replays the scenario with the current engine and compares:
+ * an engine that draws the same random numbers in the same order must reproduce it bit-exactly,
+ * one that doesn't must at least produce a fitness distribution the tests can't tell apart.
+ *
+ * runScenariosFromFile: drives a whole suite, such as GoldenScenarios/Scenarios.plist: an array of definitions, each
+ * a dictionary with name, seed, team (its parameters) and simulation (the parameters that differ from Simulation's
+ * defaults). Scenarios not yet recorded in directory are recorded with the current build, the rest verified against
+ * their recordings; pointing directory at GoldenScenarios keeps the recordings next to the definitions.
+ * Definitions marked baseline are instead recorded (without traces) by the pre-optimization engine, see
+ * GoldenScenarios/golden.sh, and fail until they are.
+ */
+@interface GoldenTrace : NSObject
+
+-(id) initWithDirectory:(NSString*)directory;
+
+-(BOOL) recordScenario:(NSString*)name withParameters:(NSMutableDictionary*)parameters team:(Team*)team seed:(unsigned)seed;
+-(GoldenVerdict) verifyScenario:(NSString*)name;
+-(NSDictionary*) runScenariosFromFile:(NSString*)file;
++(NSString*) descriptionOfVerdict:(GoldenVerdict)verdict;
+
+@property (nonatomic) NSString* directory;
+@property (nonatomic) int evaluations; //Evaluations recorded per scenario; enough for the tests to have power.
+@property (nonatomic) double significance; //Level at which either test rejects.
+
+@end
@@ -0,0 +1,333 @@
+#import "GoldenTrace.h"
+#import "SensorError.h"
+#import "Simulation.h"
+#import "Team.h"
+#import "Trace.h"
+#import <algorithm>
+#import <cmath>
+
+using namespace std;
+
+#define GOLDEN_SCENARIO_FILE @"scenario.plist"
+
+/*
+ * Returns the first tick at which two traces differ in any robot, pickup or pheromone, or -1 if they are identical.
+ * Traces that can't be read or don't describe the same world differ from the start.
+ */
+static int firstDivergentTick(const char* expectedPath, const char* actualPath) {
+    TraceReader expected, actual;
+    if(!expected.open(expectedPath) || !actual.open(actualPath) || (expected.getRobotCount() != actual.getRobotCount()) ||
+       (expected.getWidth() != actual.getWidth()) || (expected.getHeight() != actual.getHeight())) {
+        return 0;
+    }
+    
+    while(YES) {
+        bool expectedMore = expected.next();
+        bool actualMore = actual.next();
+        if(!expectedMore || !actualMore) {
+            return (expectedMore == actualMore) ? -1 : (expectedMore ? expected.tick() : actual.tick());
+        }
+        
+        int tick = min(expected.tick(), actual.tick());
+        if(expected.tick() != actual.tick()) {
+            return tick;
+        }
+        for(size_t i = 0; i < expected.getRobots().size(); i++) {
+            const TraceRobot& a = expected.getRobots()[i];
+            const TraceRobot& b = actual.getRobots()[i];
+            if((a.x != b.x) || (a.y != b.y) || (a.status != b.status)) {
+                return tick;
+            }
+        }
+        if((expected.getPickups().size() != actual.getPickups().size()) ||
+           (expected.getPheromones().size() != actual.getPheromones().size())) {
+            return tick;
+        }
+        for(size_t i = 0; i < expected.getPickups().size(); i++) {
+            const TracePickup& a = expected.getPickups()[i];
+            const TracePickup& b = actual.getPickups()[i];
+            if((a.robot != b.robot) || (a.x != b.x) || (a.y != b.y)) {
+                return tick;
+            }
+        }
+        //Weights are compared bit for bit.
+        if(!expected.getPheromones().empty() &&
+           memcmp(expected.getPheromones().data(), actual.getPheromones().data(), expected.getPheromones().size() * sizeof(TracePheromone))) {
+            return tick;
+        }
+    }
+}
+
+/*
+ * Continued fraction for the regularized incomplete beta function (modified Lentz's method).
+ */
+static double betaContinuedFraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1., d = 1. - ((a + b) * x / (a + 1.));
+    d = 1. / ((fabs(d) < tiny) ? tiny : d);
+    double h = d;
+    for(int m = 1; m <= 300; m++) {
+        for(int step = 0; step < 2; step++) {
+            double numerator = (step == 0) ? (m * (b - m) * x) / ((a + 2 * m - 1) * (a + 2 * m))
+                                           : -((a + m) * (a + b + m) * x) / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1. + (numerator * d);
+            d = 1. / ((fabs(d) < tiny) ? tiny : d);
+            c = 1. + (numerator / c);
+            c = (fabs(c) < tiny) ? tiny : c;
+            h *= c * d;
+            if((step == 1) && (fabs((c * d) - 1.) < 1e-12)) {
+                return h;
+            }
+        }
+    }
+    return h;
+}
+
+/*
+ * Regularized incomplete beta function I_x(a, b).
+ */
+static double incompleteBeta(double a, double b, double x) {
+    if(x <= 0.) {
+        return 0.;
+    }
+    if(x >= 1.) {
+        return 1.;
+    }
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + (a * log(x)) + (b * log(1. - x)));
+    if(x < (a + 1.) / (a + b + 2.)) {
+        return front * betaContinuedFraction(a, b, x) / a;
+    }
+    return 1. - (front * betaContinuedFraction(b, a, 1. - x) / b);
+}
+
+/*
+ * Two-sample Kolmogorov-Smirnov test with the asymptotic distribution of the statistic.
+ */
+static void kolmogorovSmirnovTest(vector<double> a, vector<double> b, double* statistic, double* pValue) {
+    sort(a.begin(), a.end());
+    sort(b.begin(), b.end());
+    size_t i = 0, j = 0;
+    double distance = 0.;
+    while((i < a.size()) && (j < b.size())) {
+        double value = min(a[i], b[j]);
+        while((i < a.size()) && (a[i] == value)) {i++;}
+        while((j < b.size()) && (b[j] == value)) {j++;}
+        distance = max(distance, fabs(((double)i / a.size()) - ((double)j / b.size())));
+    }
+    
+    double n = sqrt((double)(a.size() * b.size()) / (a.size() + b.size()));
+    double lambda = (n + 0.12 + (0.11 / n)) * distance;
+    double p = 0.;
+    if(lambda < 0.2) {
+        p = 1.;
+    }
+    else {
+        for(int k = 1; k <= 100; k++) {
+            double term = 2. * ((k % 2) ? 1. : -1.) * exp(-2. * k * k * lambda * lambda);
+            p += term;
+            if(fabs(term) < 1e-12) {
+                break;
+            }
+        }
+    }
+    *statistic = distance;
+    *pValue = min(max(p, 0.), 1.);
+}
+
+/*
+ * Welch's unequal-variance t-test for equal means (two-sided).
+ */
+static void welchTest(const vector<double>& a, const vector<double>& b, double* statistic, double* pValue) {
+    double meanA = 0., meanB = 0., varianceA = 0., varianceB = 0.;
+    for(double x : a) {meanA += x;}
+    for(double x : b) {meanB += x;}
+    meanA /= a.size();
+    meanB /= b.size();
+    for(double x : a) {varianceA += (x - meanA) * (x - meanA);}
+    for(double x : b) {varianceB += (x - meanB) * (x - meanB);}
+    varianceA /= MAX((int)a.size() - 1, 1);
+    varianceB /= MAX((int)b.size() - 1, 1);
+    
+    double errorA = varianceA / a.size(), errorB = varianceB / b.size();
+    if(errorA + errorB <= 0.) {
+        *statistic = (meanA == meanB) ? 0. : INFINITY;
+        *pValue = (meanA == meanB) ? 1. : 0.;
+        return;
+    }
+    double t = (meanA - meanB) / sqrt(errorA + errorB);
+    double freedom = ((errorA + errorB) * (errorA + errorB)) /
+                     (((errorA * errorA) / MAX((int)a.size() - 1, 1)) + ((errorB * errorB) / MAX((int)b.size() - 1, 1)));
+    *statistic = t;
+    *pValue = incompleteBeta(freedom / 2., 0.5, freedom / (freedom + (t * t)));
+}
+
+@interface GoldenTrace()
+
+-(NSMutableDictionary*) evaluateScenario:(NSDictionary*)scenario tracingTo:(NSString*)traceDirectory;
+
+@end
+
+@implementation GoldenTrace
+
+@synthesize directory, evaluations, significance;
+
+-(id) initWithDirectory:(NSString*)_directory {
+    if(self = [super init]) {
+        directory = _directory;
+        evaluations = 30;
+        significance = 0.01;
+    }
+    return self;
+}
+
+/*
+ * Evaluates team under parameters (the defaults of Simulation if nil) from seed and saves the result as scenario name.
+ * Returns NO if it can't be saved.
+ */
+-(BOOL) recordScenario:(NSString*)name withParameters:(NSMutableDictionary*)parameters team:(Team*)team seed:(unsigned)seed {
+    NSString* path = [directory stringByAppendingPathComponent:name];
+    if(![[NSFileManager defaultManager] createDirectoryAtPath:path withIntermediateDirectories:YES attributes:nil error:nil]) {
+        return NO;
+    }
+    
+    NSMutableDictionary* scenario = [@{@"simulation":(parameters ? parameters : [[[Simulation alloc] init] getParameters]),
+                                       @"team":[team getParameters],
+                                       @"seed":@(seed),
+                                       @"evaluations":@(evaluations),
+                                       @"traced":@YES} mutableCopy];
+    NSMutableDictionary* results = [self evaluateScenario:scenario tracingTo:path];
+    [scenario setObject:[results objectForKey:@"fitness"] forKey:@"fitness"];
+    return [scenario writeToFile:[path stringByAppendingPathComponent:GOLDEN_SCENARIO_FILE] atomically:YES];
+}
+
+/*
+ * Replays scenario name with the current engine. Its traces are written to a temporary directory and removed afterwards.
+ */
+-(GoldenVerdict) verifyScenario:(NSString*)name {
+    GoldenVerdict verdict = {NO, NO, -1, -1, 0., 0., 0., 0.};
+    NSString* path = [directory stringByAppendingPathComponent:name];
+    NSDictionary* scenario = [NSDictionary dictionaryWithContentsOfFile:[path stringByAppendingPathComponent:GOLDEN_SCENARIO_FILE]];
+    if(!scenario) {
+        return verdict;
+    }
+    
+    NSString* replay = [NSTemporaryDirectory() stringByAppendingPathComponent:
+                        [NSString stringWithFormat:@"golden-%@-%d", name, [[NSProcessInfo processInfo] processIdentifier]]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:replay withIntermediateDirectories:YES attributes:nil error:nil];
+    NSArray* fitness = [[self evaluateScenario:scenario tracingTo:replay] objectForKey:@"fitness"];
+    NSArray* expectedFitness = [scenario objectForKey:@"fitness"];
+    
+    vector<double> expected, actual;
+    for(NSNumber* value in expectedFitness) {
+        expected.push_back([value doubleValue]);
+    }
+    for(NSNumber* value in fitness) {
+        actual.push_back([value doubleValue]);
+    }
+    
+    //Recordings of engines that predate traces (see golden.sh) only have their fitness to compare.
+    BOOL traced = ![scenario objectForKey:@"traced"] || [[scenario objectForKey:@"traced"] boolValue];
+    for(int i = 0; (verdict.divergentEvaluation < 0) && (i < (int)MAX(expected.size(), actual.size())); i++) {
+        NSString* trace = [NSString stringWithFormat:@"evaluation-%d.trace", i];
+        int tick = !traced ? -1 : firstDivergentTick([[path stringByAppendingPathComponent:trace] fileSystemRepresentation],
+                                                     [[replay stringByAppendingPathComponent:trace] fileSystemRepresentation]);
+        if((i >= (int)expected.size()) || (i >= (int)actual.size()) || (expected[i] != actual[i]) || (tick >= 0)) {
+            verdict.divergentEvaluation = i;
+            verdict.divergentTick = tick;
+        }
+    }
+    [[NSFileManager defaultManager] removeItemAtPath:replay error:nil];
+    verdict.bitExact = (verdict.divergentEvaluation < 0);
+    
+    if(!expected.empty() && !actual.empty()) {
+        kolmogorovSmirnovTest(expected, actual, &verdict.ksStatistic, &verdict.ksPValue);
+        welchTest(expected, actual, &verdict.welchStatistic, &verdict.welchPValue);
+    }
+    verdict.passed = verdict.bitExact || ((verdict.ksPValue >= significance) && (verdict.welchPValue >= significance));
+    return verdict;
+}
+
++(NSString*) descriptionOfVerdict:(GoldenVerdict)verdict {
+    NSString* match = verdict.bitExact ? @"bit-exact" :
+                      [NSString stringWithFormat:@"diverged at evaluation %d, tick %d", verdict.divergentEvaluation, verdict.divergentTick];
+    return [NSString stringWithFormat:@"%@ (%@) KS D=%.4f p=%.4f Welch t=%.4f p=%.4f", verdict.passed ? @"passed" : @"FAILED", match,
+            verdict.ksStatistic, verdict.ksPValue, verdict.welchStatistic, verdict.welchPValue];
+}
+
+/*
+ * Records or verifies every scenario defined in file (see GoldenTrace.h).
+ * Returns a description of the outcome for each scenario by name, starting with "recorded", "passed" or "FAILED",
+ * or nil if file can't be read.
+ */
+-(NSDictionary*) runScenariosFromFile:(NSString*)file {
+    NSArray* definitions = [NSArray arrayWithContentsOfFile:file];
+    if(!definitions) {
+        return nil;
+    }
+    
+    NSMutableDictionary* outcomes = [[NSMutableDictionary alloc] init];
+    for(NSDictionary* definition in definitions) {
+        NSString* name = [definition objectForKey:@"name"];
+        NSDictionary* overrides = [definition objectForKey:@"simulation"];
+        Team* team = [[Team alloc] init];
+        [team setParameters:[definition objectForKey:@"team"]];
+        unsigned definitionSeed = [[definition objectForKey:@"seed"] unsignedIntValue];
+        NSDictionary* recorded = [NSDictionary dictionaryWithContentsOfFile:
+                                  [[directory stringByAppendingPathComponent:name] stringByAppendingPathComponent:GOLDEN_SCENARIO_FILE]];
+        
+        //Baseline scenarios must be recorded by the pre-optimization engine, never by the build under test.
+        if(!recorded && [[definition objectForKey:@"baseline"] boolValue]) {
+            [outcomes setObject:@"FAILED (no baseline recording; run golden.sh record-baseline)" forKey:name];
+            continue;
+        }
+        
+        if(!recorded) {
+            NSMutableDictionary* parameters = [[[Simulation alloc] init] getParameters];
+            [parameters addEntriesFromDictionary:overrides];
+            BOOL saved = [self recordScenario:name withParameters:parameters team:team seed:definitionSeed];
+            [outcomes setObject:(saved ? @"recorded" : @"FAILED (could not save the recording)") forKey:name];
+            continue;
+        }
+        
+        //A recording of an earlier version of the definition says nothing about the current one.
+        BOOL stale = ([[recorded objectForKey:@"seed"] unsignedIntValue] != definitionSeed) ||
+                     ![[recorded objectForKey:@"team"] isEqualToDictionary:[team getParameters]];
+        for(NSString* key in overrides) {
+            if(![[[recorded objectForKey:@"simulation"] objectForKey:key] isEqual:[overrides objectForKey:key]]) {
+                stale = YES;
+            }
+        }
+        if(stale) {
+            [outcomes setObject:@"FAILED (recording does not match its definition; delete it to record again)" forKey:name];
+            continue;
+        }
+        
+        [outcomes setObject:[GoldenTrace descriptionOfVerdict:[self verifyScenario:name]] forKey:name];
+    }
+    return outcomes;
+}
+
+/*
+ * Runs the scenario's evaluations of its team on the calling thread from its seed, writing one trace per evaluation.
+ */
+-(NSMutableDictionary*) evaluateScenario:(NSDictionary*)scenario tracingTo:(NSString*)traceDirectory {
+    Simulation* simulation = [[Simulation alloc] init];
+    
+    //Baseline recordings only carry the keys the old engine had; the rest keep today's defaults.
+    NSMutableDictionary* parameters = [simulation getParameters];
+    [parameters addEntriesFromDictionary:[scenario objectForKey:@"simulation"]];
+    [simulation setParameters:parameters];
+    [simulation setPostEvaluations:[[scenario objectForKey:@"evaluations"] intValue]];
+    [simulation setKeepPostEvaluationSamples:YES];
+    [simulation setTraceDirectory:traceDirectory];
+    [simulation setError:[simulation observedError] ? [[SensorError alloc] initObserved] : [[SensorError alloc] init]];
+    
+    Team* team = [[Team alloc] init];
+    [team setParameters:[[scenario objectForKey:@"team"] mutableCopy]];
+    
+    srandom([[scenario objectForKey:@"seed"] unsignedIntValue]);
+    TiledGrid grid([simulation gridSize].width, [simulation gridSize].height);
+    return [simulation evaluateTeam:team onGrid:grid];
+}
+
+@end
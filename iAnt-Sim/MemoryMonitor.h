@@ -0,0 +1,44 @@
+#import <Foundation/Foundation.h>
+
+/*
+ * Classes whose live instances are counted (see trackAllocation and trackDeallocation).
+ */
+typedef enum {
+    MemoryClassTag,
+    MemoryClassPheromone,
+    MemoryClassCell,
+    MemoryClassRobot,
+    MemoryClassTeam,
+    MemoryClassCluster,
+    MEMORY_CLASS_COUNT
+} MemoryClass;
+
+/*
+ * Snapshot of process memory use.
+ * Byte counts are -1 where the platform does not provide them.
+ */
+typedef struct {
+    long long residentBytes;
+    long long peakResidentBytes;
+    int liveObjects[MEMORY_CLASS_COUNT]; //Indexed by MemoryClass.
+} MemoryReport;
+
+extern volatile int liveObjectCounts[MEMORY_CLASS_COUNT];
+
+/*
+ * Called from +allocWithZone: and -dealloc of the tracked classes.
+ */
+static inline void trackAllocation(MemoryClass memoryClass) {
+    __sync_fetch_and_add(&liveObjectCounts[memoryClass], 1);
+}
+
+static inline void trackDeallocation(MemoryClass memoryClass) {
+    __sync_fetch_and_sub(&liveObjectCounts[memoryClass], 1);
+}
+
+@interface MemoryMonitor : NSObject
+
++(MemoryReport) currentReport;
++(NSString*) descriptionOfReport:(MemoryReport)report;
+
+@end
@@ -0,0 +1,66 @@
+#import "MemoryMonitor.h"
+#import <sys/resource.h>
+#import <unistd.h>
+#ifdef __APPLE__
+#import <mach/mach.h>
+#endif
+
+volatile int liveObjectCounts[MEMORY_CLASS_COUNT];
+
+static NSString* const MemoryClassNames[MEMORY_CLASS_COUNT] = {
+    @"Tag", @"Pheromone", @"Cell", @"Robot", @"Team", @"Cluster"
+};
+
+@implementation MemoryMonitor
+
+/*
+ * Returns current and peak resident set size along with live instance counts.
+ */
++(MemoryReport) currentReport {
+    MemoryReport report;
+    report.residentBytes = -1;
+    report.peakResidentBytes = -1;
+
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        report.peakResidentBytes = usage.ru_maxrss; //Bytes on OS X
+#else
+        report.peakResidentBytes = usage.ru_maxrss * 1024LL; //Kilobytes on Linux
+#endif
+    }
+
+#ifdef __APPLE__
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+        report.residentBytes = info.resident_size;
+    }
+#else
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if(statm) {
+        long long pages, residentPages;
+        if(fscanf(statm, "%lld %lld", &pages, &residentPages) == 2) {
+            report.residentBytes = residentPages * sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+#endif
+
+    for(int i = 0; i < MEMORY_CLASS_COUNT; i++) {
+        report.liveObjects[i] = liveObjectCounts[i];
+    }
+
+    return report;
+}
+
++(NSString*) descriptionOfReport:(MemoryReport)report {
+    NSMutableString* description = [NSMutableString stringWithFormat:@"rss=%.1fMB peak=%.1fMB",
+                                    report.residentBytes / 1048576., report.peakResidentBytes / 1048576.];
+    for(int i = 0; i < MEMORY_CLASS_COUNT; i++) {
+        [description appendFormat:@" %@=%d", MemoryClassNames[i], report.liveObjects[i]];
+    }
+    return description;
+}
+
+@end
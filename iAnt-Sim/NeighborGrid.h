@@ -0,0 +1,24 @@
+#import <Foundation/Foundation.h>
+
+/*
+ * Uniform-grid spatial hash of robot positions.
+ * Robots are identified by index and kept in per-bucket doubly linked lists, so insertion,
+ * removal and moves are constant time and a radius query only visits nearby buckets.
+ */
+@interface NeighborGrid : NSObject
+
+-(id) initWithSize:(NSSize)_size bucketSize:(int)_bucketSize andCapacity:(int)_capacity;
+
+-(void) clear;
+-(void) moveRobot:(int)index to:(NSPoint)position;
+-(void) removeRobot:(int)index;
+
+-(int) neighborsOfRobot:(int)index withinRadius:(float)radius into:(int*)neighbors maxCount:(int)maxCount;
+-(BOOL) nearestNeighborOfRobot:(int)index withinRadius:(float)radius position:(NSPoint*)neighborPosition;
+-(NSPoint) positionOfRobot:(int)index;
+
+@property (readonly, nonatomic) NSSize size;
+@property (readonly, nonatomic) int bucketSize;
+@property (readonly, nonatomic) int capacity;
+
+@end
@@ -0,0 +1,160 @@
+#import "NeighborGrid.h"
+#import "Utilities.h"
+
+@implementation NeighborGrid {
+    int columns, rows;
+    int* heads; //First robot in each bucket, -1 if empty.
+    int* next;
+    int* previous;
+    int* buckets; //Bucket each robot is in, -1 if not in the grid.
+    NSPoint* positions;
+}
+
+@synthesize size, bucketSize, capacity;
+
+-(id) initWithSize:(NSSize)_size bucketSize:(int)_bucketSize andCapacity:(int)_capacity {
+    if(self = [super init]) {
+        size = _size;
+        bucketSize = MAX(_bucketSize, 1);
+        capacity = _capacity;
+        columns = (int)ceil(size.width / bucketSize);
+        rows = (int)ceil(size.height / bucketSize);
+
+        heads = malloc(columns * rows * sizeof(int));
+        next = malloc(capacity * sizeof(int));
+        previous = malloc(capacity * sizeof(int));
+        buckets = malloc(capacity * sizeof(int));
+        positions = malloc(capacity * sizeof(NSPoint));
+        [self clear];
+    }
+    return self;
+}
+
+-(void) dealloc {
+    free(heads);
+    free(next);
+    free(previous);
+    free(buckets);
+    free(positions);
+}
+
+-(void) clear {
+    for(int i = 0; i < columns * rows; i++) {
+        heads[i] = -1;
+    }
+    for(int i = 0; i < capacity; i++) {
+        next[i] = previous[i] = buckets[i] = -1;
+        positions[i] = NSNullPoint;
+    }
+}
+
+-(void) removeRobot:(int)index {
+    int bucket = buckets[index];
+    if(bucket < 0) {
+        return;
+    }
+
+    if(previous[index] >= 0) {
+        next[previous[index]] = next[index];
+    }
+    else {
+        heads[bucket] = next[index];
+    }
+    if(next[index] >= 0) {
+        previous[next[index]] = previous[index];
+    }
+
+    next[index] = previous[index] = buckets[index] = -1;
+    positions[index] = NSNullPoint;
+}
+
+/*
+ * Records a robot's new position, relinking it only when it crosses into another bucket.
+ * Positions outside the world (e.g. NSNullPoint) remove the robot from the grid.
+ */
+-(void) moveRobot:(int)index to:(NSPoint)position {
+    if(position.x < 0 || position.y < 0 || position.x >= size.width || position.y >= size.height) {
+        [self removeRobot:index];
+        return;
+    }
+
+    int bucket = ((int)position.y / bucketSize) * columns + ((int)position.x / bucketSize);
+    if(bucket != buckets[index]) {
+        [self removeRobot:index];
+        buckets[index] = bucket;
+        previous[index] = -1;
+        next[index] = heads[bucket];
+        if(heads[bucket] >= 0) {
+            previous[heads[bucket]] = index;
+        }
+        heads[bucket] = index;
+    }
+    positions[index] = position;
+}
+
+-(NSPoint) positionOfRobot:(int)index {
+    return positions[index];
+}
+
+/*
+ * Writes the indices of up to maxCount robots within radius of robot index into neighbors.
+ * Returns the number written.
+ */
+-(int) neighborsOfRobot:(int)index withinRadius:(float)radius into:(int*)neighbors maxCount:(int)maxCount {
+    if(buckets[index] < 0) {
+        return 0;
+    }
+
+    NSPoint p = positions[index];
+    int minColumn = MAX((int)(p.x - radius) / bucketSize, 0), maxColumn = MIN((int)(p.x + radius) / bucketSize, columns - 1);
+    int minRow = MAX((int)(p.y - radius) / bucketSize, 0), maxRow = MIN((int)(p.y + radius) / bucketSize, rows - 1);
+    int count = 0;
+
+    for(int row = minRow; row <= maxRow; row++) {
+        for(int column = minColumn; column <= maxColumn; column++) {
+            for(int other = heads[row * columns + column]; other >= 0; other = next[other]) {
+                if(other != index && pointDistance(p.x, p.y, positions[other].x, positions[other].y) <= radius) {
+                    if(count == maxCount) {
+                        return count;
+                    }
+                    neighbors[count++] = other;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Finds the closest robot within radius of robot index.
+ * Returns NO (leaving neighborPosition untouched) if there is none.
+ */
+-(BOOL) nearestNeighborOfRobot:(int)index withinRadius:(float)radius position:(NSPoint*)neighborPosition {
+    if(buckets[index] < 0) {
+        return NO;
+    }
+
+    NSPoint p = positions[index];
+    int minColumn = MAX((int)(p.x - radius) / bucketSize, 0), maxColumn = MIN((int)(p.x + radius) / bucketSize, columns - 1);
+    int minRow = MAX((int)(p.y - radius) / bucketSize, 0), maxRow = MIN((int)(p.y + radius) / bucketSize, rows - 1);
+    float nearest = radius;
+    BOOL found = NO;
+
+    for(int row = minRow; row <= maxRow; row++) {
+        for(int column = minColumn; column <= maxColumn; column++) {
+            for(int other = heads[row * columns + column]; other >= 0; other = next[other]) {
+                float distance = pointDistance(p.x, p.y, positions[other].x, positions[other].y);
+                if(other != index && distance <= nearest) {
+                    nearest = distance;
+                    *neighborPosition = positions[other];
+                    found = YES;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+@end
@@ -0,0 +1,23 @@
+#import <Foundation/Foundation.h>
+
+//Worlds larger than this fall back to Robot moveWithin: (the table costs 44 bytes per cell).
+#define NEST_FIELD_MAX_CELLS (1 << 18)
+
+/*
+ * Distance field and move-weight table toward the nest.
+ * Built once per world, it lets returning robots take the same weighted step as moveWithin:
+ * (including its single random draw) with a table lookup instead of eight distance computations.
+ * Distances are Euclidean for now; obstacles would only change how the field is filled.
+ */
+@interface NestField : NSObject
+
+-(id) initWithSize:(NSSize)_size andNest:(NSPoint)_nest;
+
+-(BOOL) matchesSize:(NSSize)_size andNest:(NSPoint)_nest;
+-(float) distanceFrom:(NSPoint)position;
+-(NSPoint) stepFrom:(NSPoint)position;
+
+@property (readonly, nonatomic) NSSize size;
+@property (readonly, nonatomic) NSPoint nest;
+
+@end
@@ -0,0 +1,91 @@
+#import "NestField.h"
+#import "Utilities.h"
+
+@implementation NestField {
+    int width, height;
+    float* distances;
+    float* weights; //9 per cell, indexed (dx + 1) * 3 + (dy + 1) to match the order moveWithin: draws in.
+    float* weightSums;
+}
+
+@synthesize size, nest;
+
+-(id) initWithSize:(NSSize)_size andNest:(NSPoint)_nest {
+    if(self = [super init]) {
+        size = _size;
+        nest = _nest;
+        width = (int)size.width;
+        height = (int)size.height;
+
+        distances = malloc(width * height * sizeof(float));
+        weights = malloc(width * height * 9 * sizeof(float));
+        weightSums = malloc(width * height * sizeof(float));
+
+        for(int y = 0; y < height; y++) {
+            for(int x = 0; x < width; x++) {
+                distances[y * width + x] = pointDistance(x, y, nest.x, nest.y);
+            }
+        }
+
+        //Same improvements, bounds and summation order as moveWithin:, so steps are bit-identical.
+        for(int y = 0; y < height; y++) {
+            for(int x = 0; x < width; x++) {
+                int cell = y * width + x;
+                float* cellWeights = &weights[cell * 9];
+                float sum = 0;
+                for(int dx = -1; dx <= 1; dx++) {
+                    for(int dy = -1; dy <= 1; dy++) {
+                        float improvement = 0.;
+                        if((dx || dy) && x + dx >= 0 && y + dy >= 0 && x + dx < width && y + dy < height) {
+                            improvement = distances[cell] - distances[(y + dy) * width + (x + dx)];
+                            if(improvement > 0.f) {
+                                sum += improvement;
+                            }
+                            else{improvement = 0.;}
+                        }
+                        cellWeights[(dx + 1) * 3 + (dy + 1)] = improvement;
+                    }
+                }
+                weightSums[cell] = sum;
+            }
+        }
+    }
+    return self;
+}
+
+-(void) dealloc {
+    free(distances);
+    free(weights);
+    free(weightSums);
+}
+
+-(BOOL) matchesSize:(NSSize)_size andNest:(NSPoint)_nest {
+    return NSEqualSizes(size, _size) && NSEqualPoints(nest, _nest);
+}
+
+-(float) distanceFrom:(NSPoint)position {
+    return distances[(int)position.y * width + (int)position.x];
+}
+
+/*
+ * Returns the cell a robot at position moves to on its way to the nest.
+ */
+-(NSPoint) stepFrom:(NSPoint)position {
+    if(NSEqualPoints(position, nest)){return position;}
+
+    //moveWithin: steps straight onto an adjacent target without drawing a random number.
+    if(fabsf(position.x - nest.x) <= 1 && fabsf(position.y - nest.y) <= 1){return nest;}
+
+    int x = (int)position.x;
+    int y = (int)position.y;
+    int cell = y * width + x;
+    const float* cellWeights = &weights[cell * 9];
+    float r = randomFloat(weightSums[cell]);
+    for(int i = 0; i < 9; i++) {
+        if(r < cellWeights[i]){return NSMakePoint(x + (i / 3) - 1, y + (i % 3) - 1);}
+        r -= cellWeights[i];
+    }
+    return position;
+}
+
+@end
@@ -0,0 +1,86 @@
+#import <Foundation/Foundation.h>
+
+#ifdef __cplusplus
+
+#import <atomic>
+
+/*
+ * Parts of a run that are measured separately. Phases nest (e.g. clustering runs inside the tick loop);
+ * time and counts go to the innermost phase only.
+ */
+typedef enum {
+    PerformancePhaseTicks,
+    PerformancePhaseDistribution,
+    PerformancePhaseClustering,
+    PerformancePhaseBreeding,
+    PERFORMANCE_PHASE_COUNT
+} PerformancePhase;
+
+typedef enum {
+    PerformanceCounterCycles,
+    PerformanceCounterInstructions,
+    PerformanceCounterCacheMisses,
+    PerformanceCounterBranchMisses,
+    PERFORMANCE_COUNTER_COUNT
+} PerformanceCounter;
+
+#define PERFORMANCE_MAX_DEPTH 8 //Deeper nesting is folded into the enclosing phase.
+
+struct CounterReading;
+
+/*
+ * Per-phase wall time and, on Linux, hardware counters (through perf_event_open), summed over every thread
+ * that enters a phase. Each thread opens its own counters the first time it measures anything and keeps them;
+ * elsewhere, or if the kernel refuses (see perf_event_paranoid), only time is measured.
+ * Counts of counters that were multiplexed with other events are scaled up to the time they were enabled.
+ */
+class PerformanceCounters {
+    std::atomic<uint64_t> counts[PERFORMANCE_PHASE_COUNT][PERFORMANCE_COUNTER_COUNT];
+    std::atomic<uint64_t> nanoseconds[PERFORMANCE_PHASE_COUNT];
+    std::atomic<uint64_t> calls[PERFORMANCE_PHASE_COUNT];
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> robotTicks;
+    std::atomic<bool> hardware; //Some thread got counters.
+
+    void attribute(int phase, const CounterReading& now);
+
+public:
+    PerformanceCounters();
+
+    void begin(PerformancePhase phase);
+    void end();
+    void addTicks(int tickCount, int robotCount);
+
+    bool hasHardwareCounters() const {return hardware;}
+    uint64_t count(PerformancePhase phase, PerformanceCounter counter) const {return counts[phase][counter];}
+    double seconds(PerformancePhase phase) const {return nanoseconds[phase] * 1e-9;}
+    uint64_t callCount(PerformancePhase phase) const {return calls[phase];}
+    uint64_t tickCount() const {return ticks;}
+    uint64_t robotTickCount() const {return robotTicks;}
+};
+
+/*
+ * Measures the enclosing scope as phase; does nothing if counters is NULL.
+ */
+class PerformanceScope {
+    PerformanceCounters* counters;
+
+public:
+    PerformanceScope(PerformanceCounters* _counters, PerformancePhase phase) : counters(_counters) {
+        if(counters) {
+            counters->begin(phase);
+        }
+    }
+    ~PerformanceScope() {
+        if(counters) {
+            counters->end();
+        }
+    }
+};
+
+/*
+ * One line per phase with its totals normalized per simulated tick and per robot-tick.
+ */
+NSString* descriptionOfPerformanceCounters(const PerformanceCounters& counters);
+
+#endif
@@ -0,0 +1,234 @@
+#import "PerformanceCounters.h"
+#import "Utilities.h"
+#ifdef __linux__
+#import <linux/perf_event.h>
+#import <pthread.h>
+#import <sys/ioctl.h>
+#import <sys/syscall.h>
+#import <unistd.h>
+#endif
+
+static const char* const PerformancePhaseNames[PERFORMANCE_PHASE_COUNT] = {"ticks", "distribution", "clustering", "breeding"};
+
+#define PERFORMANCE_UNOPENED -2
+
+/*
+ * Raw readings of a thread's counters. The kernel counts only while the group is scheduled (timeRunning of timeEnabled),
+ * so deltas of both times are needed to scale a delta of the counts.
+ */
+struct CounterReading {
+    uint64_t values[PERFORMANCE_COUNTER_COUNT];
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+    double seconds;
+};
+
+/*
+ * What a thread is measuring: its counter group, the phases it is inside of and the reading taken when it last switched phase.
+ */
+struct ThreadCounters {
+    int group; //Leader descriptor; -1 if counters are unavailable, PERFORMANCE_UNOPENED before the first attempt.
+    int member[PERFORMANCE_COUNTER_COUNT]; //Position of each counter in a group read, -1 if it could not be opened.
+    int memberCount;
+    const PerformanceCounters* owner; //The phase stack belongs to this object; a thread may measure for several in turn.
+    int depth;
+    int skipped; //Phases begun beyond PERFORMANCE_MAX_DEPTH.
+    int phases[PERFORMANCE_MAX_DEPTH];
+    CounterReading last;
+};
+
+static __thread ThreadCounters threadCounters = {PERFORMANCE_UNOPENED};
+
+#ifdef __linux__
+static const uint64_t PerformanceEventConfigs[PERFORMANCE_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+//Holds each thread's open descriptors (a -1 terminated array) so they are closed when the thread exits.
+static pthread_key_t descriptorsKey;
+static pthread_once_t descriptorsKeyOnce = PTHREAD_ONCE_INIT;
+
+static void closeDescriptors(void* value) {
+    int* descriptors = (int*)value;
+    for(int i = 0; descriptors[i] >= 0; i++) {
+        close(descriptors[i]);
+    }
+    free(descriptors);
+}
+
+static void createDescriptorsKey() {
+    pthread_key_create(&descriptorsKey, closeDescriptors);
+}
+
+static int openCounter(uint64_t config, int group) {
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.size = sizeof(attributes);
+    attributes.config = config;
+    attributes.disabled = (group == -1); //Members follow the leader.
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, group, 0); //This thread, any CPU.
+}
+#endif
+
+/*
+ * Opens the calling thread's counters, grouped so they are always scheduled together.
+ * They stay open until the thread exits.
+ */
+static void openThreadCounters(ThreadCounters& thread) {
+    thread.group = -1;
+    thread.memberCount = 0;
+    for(int i = 0; i < PERFORMANCE_COUNTER_COUNT; i++) {
+        thread.member[i] = -1;
+    }
+#ifdef __linux__
+    int* descriptors = (int*)malloc((PERFORMANCE_COUNTER_COUNT + 1) * sizeof(int));
+    for(int i = 0; i < PERFORMANCE_COUNTER_COUNT; i++) {
+        int descriptor = openCounter(PerformanceEventConfigs[i], thread.group);
+        if(descriptor < 0) {
+            continue;
+        }
+        if(thread.group < 0) {
+            thread.group = descriptor;
+        }
+        descriptors[thread.memberCount] = descriptor;
+        thread.member[i] = thread.memberCount++;
+    }
+    descriptors[thread.memberCount] = -1;
+    if(thread.group >= 0) {
+        ioctl(thread.group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        pthread_once(&descriptorsKeyOnce, createDescriptorsKey);
+        pthread_setspecific(descriptorsKey, descriptors);
+    }
+    else {
+        free(descriptors);
+    }
+#endif
+}
+
+/*
+ * Reads the calling thread's raw counters (zero where unavailable) and the clock.
+ */
+static void sampleThreadCounters(ThreadCounters& thread, CounterReading& reading) {
+    memset(&reading, 0, sizeof(reading));
+    reading.seconds = monotonicSeconds();
+#ifdef __linux__
+    if(thread.group < 0) {
+        return;
+    }
+    struct {
+        uint64_t count;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+        uint64_t values[PERFORMANCE_COUNTER_COUNT];
+    } data;
+    if(read(thread.group, &data, sizeof(data)) < (ssize_t)(3 + thread.memberCount) * (ssize_t)sizeof(uint64_t)) {
+        reading = thread.last; //Nothing is attributed for an interval that can't be read.
+        reading.seconds = monotonicSeconds();
+        return;
+    }
+    reading.timeEnabled = data.timeEnabled;
+    reading.timeRunning = data.timeRunning;
+    for(int i = 0; i < PERFORMANCE_COUNTER_COUNT; i++) {
+        if(thread.member[i] >= 0) {
+            reading.values[i] = data.values[thread.member[i]];
+        }
+    }
+#endif
+}
+
+PerformanceCounters::PerformanceCounters() : ticks(0), robotTicks(0), hardware(false) {
+    for(int p = 0; p < PERFORMANCE_PHASE_COUNT; p++) {
+        for(int c = 0; c < PERFORMANCE_COUNTER_COUNT; c++) {
+            counts[p][c] = 0;
+        }
+        nanoseconds[p] = 0;
+        calls[p] = 0;
+    }
+}
+
+/*
+ * Adds everything since the thread's last reading to phase.
+ * Raw counts only grow, so their deltas are scaled, never the readings themselves.
+ */
+void PerformanceCounters::attribute(int phase, const CounterReading& now) {
+    ThreadCounters& thread = threadCounters;
+    uint64_t enabled = now.timeEnabled - thread.last.timeEnabled;
+    uint64_t running = now.timeRunning - thread.last.timeRunning;
+    double scale = running ? (double)enabled / running : 0.;
+    for(int c = 0; c < PERFORMANCE_COUNTER_COUNT; c++) {
+        counts[phase][c] += (uint64_t)((now.values[c] - thread.last.values[c]) * scale);
+    }
+    nanoseconds[phase] += (uint64_t)((now.seconds - thread.last.seconds) * 1e9);
+}
+
+void PerformanceCounters::begin(PerformancePhase phase) {
+    ThreadCounters& thread = threadCounters;
+    if(thread.group == PERFORMANCE_UNOPENED) {
+        openThreadCounters(thread);
+    }
+    if(thread.group >= 0) {
+        hardware = true;
+    }
+    if(thread.owner != this) {
+        thread.owner = this;
+        thread.depth = 0;
+        thread.skipped = 0;
+    }
+    if(thread.depth == PERFORMANCE_MAX_DEPTH) {
+        thread.skipped++;
+        return;
+    }
+    
+    CounterReading now;
+    sampleThreadCounters(thread, now);
+    if(thread.depth > 0) {
+        attribute(thread.phases[thread.depth - 1], now);
+    }
+    thread.phases[thread.depth++] = phase;
+    thread.last = now;
+    calls[phase]++;
+}
+
+void PerformanceCounters::end() {
+    ThreadCounters& thread = threadCounters;
+    if(thread.owner != this || thread.depth == 0) {
+        return;
+    }
+    if(thread.skipped) {
+        thread.skipped--;
+        return;
+    }
+    
+    CounterReading now;
+    sampleThreadCounters(thread, now);
+    attribute(thread.phases[--thread.depth], now);
+    thread.last = now;
+}
+
+void PerformanceCounters::addTicks(int tickCount, int robotCount) {
+    ticks += tickCount;
+    robotTicks += (uint64_t)tickCount * robotCount;
+}
+
+NSString* descriptionOfPerformanceCounters(const PerformanceCounters& counters) {
+    double ticks = MAX((double)counters.tickCount(), 1.);
+    double robotTicks = MAX((double)counters.robotTickCount(), 1.);
+    NSMutableString* description = [NSMutableString stringWithFormat:@"%llu ticks, %llu robot-ticks%@\n",
+                                    counters.tickCount(), counters.robotTickCount(), counters.hasHardwareCounters() ? @"" : @" (no hardware counters)"];
+    [description appendString:@"phase         calls  seconds  us/tick  cycles/tick  instructions/tick   IPC  cache-misses/tick  branch-misses/tick  cycles/robot-tick\n"];
+    for(int p = 0; p < PERFORMANCE_PHASE_COUNT; p++) {
+        PerformancePhase phase = (PerformancePhase)p;
+        double cycles = counters.count(phase, PerformanceCounterCycles);
+        double instructions = counters.count(phase, PerformanceCounterInstructions);
+        [description appendFormat:@"%-12s %6llu %8.3f %8.3f %12.0f %18.0f %5.2f %18.2f %19.2f %18.1f\n",
+         PerformancePhaseNames[p], counters.callCount(phase), counters.seconds(phase), counters.seconds(phase) * 1e6 / ticks,
+         cycles / ticks, instructions / ticks, cycles ? instructions / cycles : 0.,
+         counters.count(phase, PerformanceCounterCacheMisses) / ticks, counters.count(phase, PerformanceCounterBranchMisses) / ticks,
+         cycles / robotTicks];
+    }
+    return description;
+}
@@ -11,4 +11,68 @@
 @property (nonatomic) float decayRate;
 @property (nonatomic) int updatedTick;
 
-@end
\ No newline at end of file
+@end
+
+#ifdef __cplusplus
+
+#import <vector>
+
+/*
+ * Plain pheromone record used inside the tick loop.
+ * Stored by value in a reused vector so laying a pheromone does not allocate an object.
+ */
+struct PheromoneRecord {
+    NSPoint position;
+    float weight;
+    float decayRate;
+    int updatedTick;
+};
+
+/*
+ * Decays every record to tick and compacts away the ones that have decayed, preserving order.
+ * Returns the total weight left.
+ */
+static inline float prunePheromones(std::vector<PheromoneRecord>& pheromones, int tick) {
+    float nSum = 0.f;
+    size_t live = 0;
+    
+    for(size_t i = 0; i < pheromones.size(); i++) {
+        PheromoneRecord& pheromone = pheromones[i];
+        pheromone.weight = exponentialDecay(pheromone.weight, tick - pheromone.updatedTick, pheromone.decayRate);
+        if(pheromone.weight >= .001) {
+            pheromone.updatedTick = tick;
+            nSum += pheromone.weight;
+            pheromones[live++] = pheromone;
+        }
+    }
+    pheromones.resize(live);
+    return nSum;
+}
+
+/*
+ * Same as +[Pheromone getPheromone:atTick:], but for pheromone records.
+ */
+static inline NSPoint samplePheromone(std::vector<PheromoneRecord>& pheromones, int tick) {
+    float r = randomFloat(prunePheromones(pheromones, tick));
+    for(const PheromoneRecord& pheromone : pheromones) {
+        if(r < pheromone.weight) {
+            return pheromone.position;
+        }
+        r -= pheromone.weight;
+    }
+    
+    return NSNullPoint;
+}
+
+/*
+ * Wraps pheromone records in Pheromone objects for observers (e.g. the view delegate).
+ */
+static inline NSMutableArray* pheromoneArray(const std::vector<PheromoneRecord>& pheromones) {
+    NSMutableArray* array = [[NSMutableArray alloc] initWithCapacity:pheromones.size()];
+    for(const PheromoneRecord& pheromone : pheromones) {
+        [array addObject:[[Pheromone alloc] initWithPosition:pheromone.position weight:pheromone.weight decayRate:pheromone.decayRate andUpdatedTick:pheromone.updatedTick]];
+    }
+    return array;
+}
+
+#endif
\ No newline at end of file
@@ -1,9 +1,19 @@
 #import "Pheromone.h"
+#import "MemoryMonitor.h"
 
 @implementation Pheromone
 
 @synthesize position, weight, decayRate, updatedTick;
 
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassPheromone);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassPheromone);
+}
+
 -(id) initWithPosition:(NSPoint)_position weight:(float)_weight decayRate:(float)_decayRate andUpdatedTick:(int)_updatedTick {
     if(self = [super init]) {
         position = _position;
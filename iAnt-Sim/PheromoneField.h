@@ -0,0 +1,137 @@
+#import <Foundation/Foundation.h>
+#import "Pheromone.h"
+#import "Utilities.h"
+
+#ifdef __cplusplus
+
+#import <vector>
+
+/*
+ * Pheromone stored as mass per grid cell instead of as individual records.
+ * Deposits add to a cell, decay (and optional diffusion) is applied to the whole field every few ticks,
+ * and targets are drawn proportionally to mass by descending a binary sum tree over the cells.
+ * None of these costs depend on how many deposits have been made.
+ *
+ * Cell c is leaf tree[cellCount + c] and tree[i] = tree[2i] + tree[2i + 1] for every i below cellCount,
+ * so each leaf is summed exactly once on its way up and tree[1] is the total mass, whether or not cellCount
+ * is a power of two. The tree takes 2 * cellCount floats.
+ */
+class PheromoneField {
+    int columns;
+    int rows;
+    size_t cellCount;
+    std::vector<float> tree;
+    std::vector<float> scratch; //Diffusion buffer.
+
+    void rebuild() {
+        for(size_t i = cellCount - 1; i > 0; i--) {
+            tree[i] = tree[2 * i] + tree[2 * i + 1];
+        }
+    }
+
+public:
+    PheromoneField() : columns(0), rows(0), cellCount(1), tree(2, 0.f) {}
+
+    int width() const {return columns;}
+    int height() const {return rows;}
+
+    /*
+     * Sizes the field for a world of the given size and clears it.
+     */
+    void reset(int _width, int _height) {
+        columns = _width;
+        rows = _height;
+        cellCount = MAX((size_t)columns * (size_t)rows, (size_t)1);
+        tree.assign(2 * cellCount, 0.f);
+    }
+
+    float total() const {return tree[1];}
+
+    float massAt(int x, int y) const {return tree[cellCount + ((size_t)y * columns) + x];}
+
+    void deposit(NSPoint position, float weight) {
+        for(size_t i = cellCount + ((size_t)position.y * columns) + (size_t)position.x; i > 0; i >>= 1) {
+            tree[i] += weight;
+        }
+    }
+
+    /*
+     * Multiplies every cell by factor, then lets diffusionRate of each cell's mass spread evenly to its four neighbors
+     * (mass that would leave the world stays put). Cells falling below cutoff are cleared, as decayed records are dropped.
+     */
+    void update(float factor, float diffusionRate, float cutoff) {
+        float* cells = &tree[cellCount];
+        size_t count = (size_t)columns * rows;
+
+        for(size_t c = 0; c < count; c++) {
+            cells[c] *= factor;
+        }
+
+        if(diffusionRate > 0.f) {
+            scratch.assign(cells, cells + count);
+            float share = diffusionRate / 4;
+            for(int y = 0; y < rows; y++) {
+                for(int x = 0; x < columns; x++) {
+                    size_t c = ((size_t)y * columns) + x;
+                    float inflow = 0.f;
+                    int neighbors = 0;
+                    if(x > 0){inflow += scratch[c - 1]; neighbors++;}
+                    if(x < columns - 1){inflow += scratch[c + 1]; neighbors++;}
+                    if(y > 0){inflow += scratch[c - columns]; neighbors++;}
+                    if(y < rows - 1){inflow += scratch[c + columns]; neighbors++;}
+                    cells[c] = (scratch[c] * (1.f - (share * neighbors))) + (inflow * share);
+                }
+            }
+        }
+
+        for(size_t c = 0; c < count; c++) {
+            cells[c] = (cells[c] >= cutoff) ? cells[c] : 0.f;
+        }
+
+        rebuild();
+    }
+
+    /*
+     * Returns a cell chosen with probability proportional to its mass, or NSNullPoint if the field is empty.
+     */
+    NSPoint sample() const {
+        if(tree[1] <= 0.f) {
+            return NSNullPoint;
+        }
+
+        float r = randomFloat(tree[1]);
+        size_t i = 1;
+        while(i < cellCount) {
+            if(r < tree[2 * i] || tree[2 * i + 1] <= 0.f) {
+                i = 2 * i;
+            }
+            else {
+                r -= tree[2 * i];
+                i = 2 * i + 1;
+            }
+        }
+
+        size_t c = i - cellCount;
+        return NSMakePoint(c % columns, c / columns);
+    }
+};
+
+/*
+ * Wraps every cell holding pheromone in a Pheromone object for observers (e.g. the view delegate).
+ */
+static inline NSMutableArray* pheromoneArray(const PheromoneField& field, float decayRate, int tick) {
+    NSMutableArray* array = [[NSMutableArray alloc] init];
+    if(field.total() <= 0.f) {
+        return array;
+    }
+    for(int y = 0; y < field.height(); y++) {
+        for(int x = 0; x < field.width(); x++) {
+            if(field.massAt(x, y) > 0.f) {
+                [array addObject:[[Pheromone alloc] initWithPosition:NSMakePoint(x, y) weight:field.massAt(x, y) decayRate:decayRate andUpdatedTick:tick]];
+            }
+        }
+    }
+    return array;
+}
+
+#endif
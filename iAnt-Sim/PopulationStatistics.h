@@ -0,0 +1,114 @@
+#import <Foundation/Foundation.h>
+#import "Team.h"
+
+#define POPULATION_QUANTILE_COUNT 5
+
+/*
+ * Per-generation summary of a population of teams.
+ * All per-gene arrays are indexed in genome order (see -[Team getGenome:]).
+ * quantiles[q] holds the PopulationQuantiles[q] quantile of every gene.
+ */
+typedef struct {
+    int count;
+    int bestIndex;
+
+    float fitnessMean;
+    float fitnessVariance;
+    float fitnessMin;
+    float fitnessMax;
+
+    float mean[TEAM_PARAMETER_COUNT];
+    float variance[TEAM_PARAMETER_COUNT];
+    float min[TEAM_PARAMETER_COUNT];
+    float max[TEAM_PARAMETER_COUNT];
+    float quantiles[POPULATION_QUANTILE_COUNT][TEAM_PARAMETER_COUNT];
+    float best[TEAM_PARAMETER_COUNT];
+} PopulationStatistics;
+
+static const float PopulationQuantiles[POPULATION_QUANTILE_COUNT] = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+/*
+ * Accumulates sum, sum of squares, min and max of n contiguous floats.
+ * Values are shifted by the first element to limit cancellation in the variance.
+ * Written as a flat loop with no data-dependent branches so the compiler can vectorize it.
+ */
+static inline void accumulateColumn(const float* values, int n, float* mean, float* variance, float* min, float* max) {
+    float shift = values[0];
+    float sum = 0.f, sumSquares = 0.f;
+    float lo = values[0], hi = values[0];
+
+    for(int i = 0; i < n; i++) {
+        float d = values[i] - shift;
+        sum += d;
+        sumSquares += d * d;
+        lo = (values[i] < lo) ? values[i] : lo;
+        hi = (values[i] > hi) ? values[i] : hi;
+    }
+
+    *mean = shift + (sum / n);
+    *variance = (n > 1) ? (sumSquares - (sum * sum) / n) / (n - 1) : 0.f;
+    *min = lo;
+    *max = hi;
+}
+
+/*
+ * Partially sorts values[from, to) so that values[k] holds the element that would be there if the range were sorted.
+ * Hoare's selection algorithm; expected linear time.
+ */
+static inline void selectKth(float* values, int from, int to, int k) {
+    int left = from, right = to - 1;
+    while(left < right) {
+        float pivot = values[(left + right) / 2];
+        int i = left, j = right;
+        while(i <= j) {
+            while(values[i] < pivot){i++;}
+            while(values[j] > pivot){j--;}
+            if(i <= j) {
+                float temp = values[i];
+                values[i++] = values[j];
+                values[j--] = temp;
+            }
+        }
+        if(k <= j){right = j;}
+        else if(k >= i){left = i;}
+        else{return;}
+    }
+}
+
+/*
+ * Computes population statistics from a gene-major genome buffer.
+ * genomes[g * count + i] is gene g of individual i and fitness[i] is its (normalized) fitness.
+ * scratch must hold at least count floats; it is used for quantile selection.
+ */
+static inline void computePopulationStatistics(const float* genomes, const float* fitness, int count, float* scratch, PopulationStatistics* statistics) {
+    statistics->count = count;
+    if(count <= 0) {
+        return;
+    }
+
+    //Best individual is the first with the maximum fitness (matches the original strict comparison).
+    int bestIndex = 0;
+    for(int i = 1; i < count; i++) {
+        if(fitness[i] > fitness[bestIndex]) {
+            bestIndex = i;
+        }
+    }
+    statistics->bestIndex = bestIndex;
+    accumulateColumn(fitness, count, &statistics->fitnessMean, &statistics->fitnessVariance, &statistics->fitnessMin, &statistics->fitnessMax);
+
+    for(int g = 0; g < TEAM_PARAMETER_COUNT; g++) {
+        const float* column = genomes + (g * count);
+        accumulateColumn(column, count, &statistics->mean[g], &statistics->variance[g], &statistics->min[g], &statistics->max[g]);
+        statistics->best[g] = column[bestIndex];
+
+        //Quantiles are ascending, so each selection only needs to look right of the previous one.
+        memcpy(scratch, column, count * sizeof(float));
+        int from = 0;
+        for(int q = 0; q < POPULATION_QUANTILE_COUNT; q++) {
+            int k = (int)clip(roundf(PopulationQuantiles[q] * (count - 1)), 0, count - 1);
+            selectKth(scratch, from, count, k);
+            statistics->quantiles[q][g] = scratch[k];
+            from = k;
+        }
+    }
+}
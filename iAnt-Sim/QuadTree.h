@@ -7,6 +7,6 @@
 @property (nonatomic) NSRect shape;
 @property (nonatomic) int area;
 @property (nonatomic) double percentExplored;
-@property (nonatomic) BOOL dirty;
+@property BOOL dirty; //Set from concurrent strips (see Simulation's domainStripCount), so accessed atomically.
 
 @end
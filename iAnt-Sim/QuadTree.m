@@ -1,10 +1,11 @@
 #import "QuadTree.h"
 
-@implementation QuadTree
+@implementation QuadTree {
+    BOOL dirty;
+}
 
 @synthesize shape, area;
 @synthesize percentExplored;
-@synthesize dirty;
 
 -(id) initWithRect:(NSRect)rect{
     if(self = [super init]) {
@@ -16,4 +17,15 @@
     return self;
 }
 
+/*
+ * Readers only look at the flag after the strips that set it have been joined, so relaxed ordering suffices.
+ */
+-(BOOL) dirty {
+    return __atomic_load_n(&dirty, __ATOMIC_RELAXED);
+}
+
+-(void) setDirty:(BOOL)_dirty {
+    __atomic_store_n(&dirty, _dirty, __ATOMIC_RELAXED);
+}
+
 @end
@@ -1,5 +1,6 @@
 #import <Foundation/Foundation.h>
 #import "Team.h"
+#import "NeighborGrid.h"
 
 #define ROBOT_STATUS_INACTIVE 0
 #define ROBOT_STATUS_DEPARTING 1
@@ -10,8 +11,6 @@
 #define ROBOT_INFORMED_MEMORY 1
 #define ROBOT_INFORMED_PHEROMONE 2
 
-@class Tag;
-
 @interface Robot : NSObject {}
 
 -(void) reset;
@@ -24,11 +23,18 @@
 //In general, positions of (-1,-1) denote an empty/unused/uninitialized position.
 @property (nonatomic) NSPoint position; //Where the robot currently is.
 @property (nonatomic) NSPoint target; //Where the robot is going.
+@property (nonatomic) NSPoint waypoint; //End of the current leg of a scripted search path (e.g. spiral search).
 
 @property (nonatomic) float direction; //Direction robot is moving (used in random walk).
 @property (nonatomic) int searchTime; //Amount of ticks the robot has been performing a random walk.
 @property (nonatomic) int delay; //Number of ticks the robot is penalized to emulate physical robots (used in random walk).
 
-@property (nonatomic) NSMutableArray* discoveredTags; //Tags discovered by robot while searching
+@property (nonatomic) int discoveredTagCount; //Number of tags discovered by robot while searching (the carried tag plus detected neighbors).
+@property (nonatomic) NSPoint discoveredTagPosition; //(Perturbed) position of the tag the robot is carrying.
+
+@property (nonatomic) int index; //Position of the robot in its swarm (also its id in neighborGrid).
+
+//Optional spatial index of the swarm; if set, every position change is mirrored into it.
+@property (nonatomic) NeighborGrid* neighborGrid;
 
 @end
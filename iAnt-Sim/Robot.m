@@ -1,12 +1,23 @@
 #import "Robot.h"
 #import "Utilities.h"
+#import "MemoryMonitor.h"
 
 @implementation Robot
 
 @synthesize status, informed;
-@synthesize position, target;
+@synthesize position, target, waypoint;
 @synthesize direction, searchTime, delay;
-@synthesize discoveredTags;
+@synthesize discoveredTagCount, discoveredTagPosition;
+@synthesize index, neighborGrid;
+
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassRobot);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassRobot);
+}
 
 -(id) init {
     if (self = [super init]) {
@@ -21,11 +32,14 @@
     
     position = NSNullPoint;
     target = NSNullPoint;
+    waypoint = NSNullPoint;
+    [neighborGrid removeRobot:index];
     
     direction = randomFloat(M_2PI);
     delay = 0;
     
-    discoveredTags = nil;
+    discoveredTagCount = 0;
+    discoveredTagPosition = NSNullPoint;
 }
 
 
@@ -49,7 +63,7 @@
     for(int dx = dxMin; dx <= dxMax; dx++) {
         for(int dy = dyMin; dy <= dyMax; dy++) {
             if(dx || dy) {
-                if(x + dx == target.x && y + dy == target.y){position = target; return;}
+                if(x + dx == target.x && y + dy == target.y){[self setPosition:target]; return;}
                 float improvement = dis - pointDistance(x + dx, y + dy, target.x, target.y);
                 if(improvement > 0.f) {
                     improvementSum += improvement;
@@ -65,12 +79,22 @@
     float r = randomFloat(improvementSum);
     for(int dx = dxMin; dx <= dxMax; dx++) {
         for(int dy = dyMin; dy <= dyMax; dy++) {
-            if(r < improvements[dx + 1][dy + 1]){position = NSMakePoint(x + dx, y + dy); return;}
+            if(r < improvements[dx + 1][dy + 1]){[self setPosition:NSMakePoint(x + dx, y + dy)]; return;}
             r -= improvements[dx + 1][dy + 1];
         }
     }
 }
 
+/*
+ * Custom setter for position that keeps neighborGrid (if any) up to date.
+ */
+-(void) setPosition:(NSPoint)_position {
+    position = _position;
+    if(neighborGrid) {
+        [neighborGrid moveRobot:index to:position];
+    }
+}
+
 -(void) turnWithParameters:(Team *)params {
     //We keep track of the amount of turning the robot does so we can penalize it with a time delay
     // (emulating the physical robots)
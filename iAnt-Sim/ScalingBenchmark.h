@@ -0,0 +1,32 @@
+#import <Foundation/Foundation.h>
+#import "BarrierTiming.h"
+
+@class Simulation;
+
+/*
+ * Measures how the parallel evaluation of a generation scales with the number of worker threads.
+ * Every measurement is a headless generational run of a simulation built from parameters (see -[Simulation setParameters:])
+ * with workerLimit set to the thread count; features that skip or reorder evaluations
+ * (steady state, fitness cache, surrogate, fidelity schedule) and post evaluations are turned off.
+ *
+ * Strong scaling keeps the work fixed at evaluationsPerThread * maxThreads evaluations per team and generation;
+ * weak scaling gives every thread evaluationsPerThread evaluations per team and generation.
+ *
+ * Each result is a dictionary with threads, evaluations, seconds (spent at barriers), throughput (evaluations per second per thread),
+ * efficiency (relative to one thread) and idle (fraction of thread time spent waiting at barriers).
+ * With usePerformanceCounters it also has counters, a per-phase breakdown of the whole run (see PerformanceCounters.h).
+ */
+@interface ScalingBenchmark : NSObject
+
+-(id) initWithParameters:(NSMutableDictionary*)parameters;
+
+-(NSArray*) runStrongScaling;
+-(NSArray*) runWeakScaling;
++(NSString*) descriptionOfResults:(NSArray*)results;
+
+@property (nonatomic) NSMutableDictionary* parameters;
+@property (nonatomic) int maxThreads; //Defaults to the number of active processors.
+@property (nonatomic) int evaluationsPerThread; //At least 2, so no evaluation stops early (see evaluationCount in evaluateTeams:).
+@property (nonatomic) BOOL usePerformanceCounters;
+
+@end
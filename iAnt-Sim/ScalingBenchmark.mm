@@ -0,0 +1,134 @@
+#import "ScalingBenchmark.h"
+#import "Simulation.h"
+
+@interface ScalingBenchmark()
+
+-(BarrierTiming) timeRunWithThreads:(int)threads andEvaluationCount:(int)evaluations counters:(NSString**)counters;
+-(NSArray*) threadCounts;
+
+@end
+
+@implementation ScalingBenchmark
+
+@synthesize parameters, maxThreads, evaluationsPerThread, usePerformanceCounters;
+
+-(id) initWithParameters:(NSMutableDictionary*)_parameters {
+    if(self = [super init]) {
+        parameters = _parameters;
+        maxThreads = MAX((int)[[NSProcessInfo processInfo] activeProcessorCount], 1);
+        evaluationsPerThread = 2;
+        usePerformanceCounters = NO;
+    }
+    return self;
+}
+
+/*
+ * Same work at every thread count; efficiency is t1 / (threads * t).
+ */
+-(NSArray*) runStrongScaling {
+    NSMutableArray* results = [[NSMutableArray alloc] init];
+    int evaluations = MAX(evaluationsPerThread, 2) * maxThreads;
+    double baseline = 0.;
+    for(NSNumber* count in [self threadCounts]) {
+        int threads = [count intValue];
+        NSString* counters = nil;
+        BarrierTiming timing = [self timeRunWithThreads:threads andEvaluationCount:evaluations counters:&counters];
+        baseline = (threads == 1) ? timing.wallSeconds : baseline;
+        NSMutableDictionary* result = [@{@"threads":@(threads),
+                                         @"evaluations":@(timing.evaluations),
+                                         @"seconds":@(timing.wallSeconds),
+                                         @"throughput":@(timing.evaluations / (timing.wallSeconds * threads)),
+                                         @"efficiency":@(baseline / (threads * timing.wallSeconds)),
+                                         @"idle":@(timing.idleSeconds / (timing.idleSeconds + timing.busySeconds))} mutableCopy];
+        if(counters) {
+            [result setObject:counters forKey:@"counters"];
+        }
+        [results addObject:result];
+    }
+    return results;
+}
+
+/*
+ * Work grows with the thread count; efficiency is t1 / t.
+ */
+-(NSArray*) runWeakScaling {
+    NSMutableArray* results = [[NSMutableArray alloc] init];
+    double baseline = 0.;
+    for(NSNumber* count in [self threadCounts]) {
+        int threads = [count intValue];
+        NSString* counters = nil;
+        BarrierTiming timing = [self timeRunWithThreads:threads andEvaluationCount:MAX(evaluationsPerThread, 2) * threads counters:&counters];
+        baseline = (threads == 1) ? timing.wallSeconds : baseline;
+        NSMutableDictionary* result = [@{@"threads":@(threads),
+                                         @"evaluations":@(timing.evaluations),
+                                         @"seconds":@(timing.wallSeconds),
+                                         @"throughput":@(timing.evaluations / (timing.wallSeconds * threads)),
+                                         @"efficiency":@(baseline / timing.wallSeconds),
+                                         @"idle":@(timing.idleSeconds / (timing.idleSeconds + timing.busySeconds))} mutableCopy];
+        if(counters) {
+            [result setObject:counters forKey:@"counters"];
+        }
+        [results addObject:result];
+    }
+    return results;
+}
+
++(NSString*) descriptionOfResults:(NSArray*)results {
+    NSMutableString* description = [NSMutableString stringWithString:@"threads evaluations seconds throughput efficiency idle\n"];
+    for(NSDictionary* result in results) {
+        [description appendFormat:@"%7d %11lld %7.2f %10.2f %10.2f %4.2f\n",
+         [[result objectForKey:@"threads"] intValue], [[result objectForKey:@"evaluations"] longLongValue],
+         [[result objectForKey:@"seconds"] doubleValue], [[result objectForKey:@"throughput"] doubleValue],
+         [[result objectForKey:@"efficiency"] doubleValue], [[result objectForKey:@"idle"] doubleValue]];
+    }
+    for(NSDictionary* result in results) {
+        if([result objectForKey:@"counters"]) {
+            [description appendFormat:@"\n%d threads: %@", [[result objectForKey:@"threads"] intValue], [result objectForKey:@"counters"]];
+        }
+    }
+    return description;
+}
+
+/*
+ * Runs a fresh simulation and returns the time its generations spent at barriers,
+ * setting counters to the description of its performance counters if they are used.
+ */
+-(BarrierTiming) timeRunWithThreads:(int)threads andEvaluationCount:(int)evaluations counters:(NSString**)counters {
+    Simulation* simulation = [[Simulation alloc] init];
+    if(parameters) {
+        [simulation setParameters:[parameters mutableCopy]];
+    }
+    [simulation setEvaluationCount:evaluations];
+    [simulation setEvaluationLimit:-1];
+    [simulation setPostEvaluations:0];
+    [simulation setWorkerLimit:threads];
+    [simulation setUseSteadyState:NO];
+    [simulation setUseFitnessCache:NO];
+    [simulation setUseSurrogate:NO];
+    [simulation setFidelitySchedule:nil];
+    PerformanceCounters performanceCounters;
+    if(usePerformanceCounters) {
+        [simulation setPerformanceCounters:&performanceCounters];
+    }
+    @autoreleasepool {
+        [simulation run];
+    }
+    if(usePerformanceCounters) {
+        *counters = descriptionOfPerformanceCounters(performanceCounters);
+    }
+    return [simulation barrierTiming];
+}
+
+/*
+ * 1, 2, 4, ... up to and including maxThreads.
+ */
+-(NSArray*) threadCounts {
+    NSMutableArray* counts = [[NSMutableArray alloc] init];
+    for(int threads = 1; threads < maxThreads; threads *= 2) {
+        [counts addObject:@(threads)];
+    }
+    [counts addObject:@(MAX(maxThreads, 1))];
+    return counts;
+}
+
+@end
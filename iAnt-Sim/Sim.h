@@ -8,4 +8,5 @@
 #import <iAnt-Sim/Team.h>
 #import <iAnt-Sim/Tag.h>
 #import <iAnt-Sim/QuadTree.h>
-#import <iAnt-Sim/Cluster.h>
\ No newline at end of file
+#import <iAnt-Sim/Cluster.h>
+#import <iAnt-Sim/GoldenTrace.h>
\ No newline at end of file
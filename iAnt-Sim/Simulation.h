@@ -1,13 +1,25 @@
 #import <Foundation/Foundation.h>
 #import "Archivable.h"
+#import "BarrierTiming.h"
 #import "Cell.h"
+#import "CMAES.h"
 #import "Cluster.h"
+#import "EventPipeline.h"
+#import "FitnessCache.h"
+#import "FitnessSurrogate.h"
+#import "FrameBuffer.h"
+#import "FrameServer.h"
 #import "SensorError.h"
+#import "StreamingStatistics.h"
 #import "GA.h"
+#import "MemoryMonitor.h"
+#import "PerformanceCounters.h"
 #import "Pheromone.h"
+#import "PopulationStatistics.h"
 #import "Team.h"
 #import "Robot.h"
 #import "Tag.h"
+#import "TiledGrid.h"
 #import "Utilities.h"
 
 @class Team;
@@ -18,6 +30,13 @@
 @interface NSObject(SimulationViewNotifications)
 #ifdef __cplusplus
 -(void) updateDisplayWindowWithRobots:(NSMutableArray*)_robots team:(Team*)_team grid:(std::vector<std::vector<Cell*>>&)_grid pheromones:(NSMutableArray*)_pheromones clusters:(NSMutableArray*)_clusters;
+
+//Preferred over the method above if implemented: gets the world as stored, instead of a dense copy that allocates every cell.
+-(void) updateDisplayWindowWithRobots:(NSMutableArray*)_robots team:(Team*)_team tiledGrid:(TiledGrid&)_grid pheromones:(NSMutableArray*)_pheromones clusters:(NSMutableArray*)_clusters;
+
+//Preferred over the method above if implemented: called on a display queue, at most frameRate times per second,
+//with the newest frame snapshot. The frame must not be kept past the call.
+-(void) updateDisplayWindowWithFrame:(const SimulationFrame&)_frame;
 #endif
 @end
 
@@ -25,9 +44,14 @@
 -(void) simulationDidStart:(Simulation*)simulation;
 -(void) simulationDidFinish:(Simulation*)simulation;
 -(void) simulation:(Simulation*)simulation didFinishGeneration:(int)generation atEvaluation:(int)evaluation;
+-(void) simulation:(Simulation*)simulation didReportMemory:(MemoryReport)report atGeneration:(int)generation;
 -(void) simulation:(Simulation*)simulation didFinishTick:(int)tick;
 -(void) simulation:(Simulation*)simulation didPickupTag:(Tag*)tag atTick:(int)tick;
 -(void) simulation:(Simulation*)simulation didPlacePheromone:(Pheromone*)pheromome atTick:(int)tick;
+
+//Tick, pickup and pheromone events arrive on a dedicated thread (see EventPipeline.h).
+//Implementing this receives them in batches instead of through the three methods above.
+-(void) simulation:(Simulation*)simulation didReceiveEvents:(const SimulationEvent*)events count:(int)count;
 @end
 
 @interface Simulation : NSObject <Archivable> {
@@ -35,18 +59,23 @@
 }
 
 -(NSMutableDictionary*) run;
+-(uint64_t) configurationHash;
 
 #ifdef __cplusplus
--(void) evaluateTeams:(NSMutableArray*)teams onGrid:(std::vector<std::vector<Cell*>>)grid;
--(NSMutableDictionary*) evaluateTeam:(Team*)team onGrid:(std::vector<std::vector<Cell*>>)grid;
--(NSMutableArray*) stateTransition:(NSMutableArray*)robots inTeam:(Team*)team atTick:(int)tick onGrid:(std::vector<std::vector<Cell*>>&)grid
-                    withPheromones:(NSMutableArray*)pheromones
-                          andClusters:(NSMutableArray*)clusters;
--(void) initDistributionForArray:(std::vector<std::vector<Cell*>>&)grid;
+-(void) evaluateTeams:(NSMutableArray*)teams onGrid:(TiledGrid)grid;
+-(NSMutableDictionary*) evaluateTeam:(Team*)team onGrid:(TiledGrid)grid;
+-(int) stateTransition:(NSMutableArray*)robots inTeam:(Team*)team atTick:(int)tick onGrid:(TiledGrid&)grid
+        withPheromones:(std::vector<PheromoneRecord>&)pheromones
+              clusters:(NSMutableArray*)clusters
+      andCollectedTags:(std::vector<NSPoint>&)collectedTags;
+-(void) initDistributionForArray:(TiledGrid&)grid;
 #endif
 
 @property (readonly, nonatomic) Team* averageTeam;
 @property (readonly, nonatomic) Team* bestTeam;
+@property (readonly, nonatomic) PopulationStatistics statistics;
+@property (readonly, nonatomic) MemoryReport memoryReport; //Taken at the end of every generation.
+@property (readonly, nonatomic) BarrierTiming barrierTiming; //Summed over the generations of the last run (generational loop only).
 
 @property (nonatomic) SensorError* error;
 @property (nonatomic) BOOL observedError;
@@ -58,14 +87,36 @@
 @property (nonatomic) int evaluationCount;
 @property (nonatomic) int evaluationLimit;
 @property (nonatomic) int postEvaluations;
+@property (nonatomic) BOOL keepPostEvaluationSamples; //Return every post evaluation's results as well as their summaries; memory grows with postEvaluations.
 @property (nonatomic) int tickCount;
+@property (nonatomic) unsigned seed; //If nonzero, seeds random() at the start of run, so headless runs without concurrent evaluations repeat exactly.
 @property (nonatomic) int clusteringTagCutoff;
 
+//Stages of reduced fidelity for early generations, in order. Each is a dictionary with keys
+//untilGeneration (stage applies to generations before it), tickFraction and evaluationFraction (of tickCount and evaluationCount, default 1).
+@property (nonatomic) NSArray* fidelitySchedule;
+@property (readonly, nonatomic) long long simulatedTickBudget; //Ticks allotted to the evaluations actually simulated.
+@property (readonly, nonatomic) long long nominalTickBudget; //Ticks every generation would have been allotted at full fidelity.
+
+@property (nonatomic) int behavior; //Foraging strategy robots follow (see Constants.h); the use* flags below only apply to CPFA.
 @property (nonatomic) BOOL useTravel;
 @property (nonatomic) BOOL useGiveUp;
 @property (nonatomic) BOOL useSiteFidelity;
 @property (nonatomic) BOOL usePheromone;
 @property (nonatomic) BOOL useInformedWalk;
+@property (nonatomic) BOOL useNeighborAvoidance; //Searching robots turn away from robots they sense within neighborRadius.
+@property (nonatomic) int neighborRadius;
+@property (nonatomic) BOOL useLockstep; //Evaluate each batch of teams side by side on one world (ignored while a view or frame stream is attached; excludes domainStripCount).
+@property (nonatomic) int domainStripCount; //If > 1, split each evaluation's world into about this many strips run in parallel.
+@property (nonatomic) BOOL useSteadyState; //Replace one team at a time as children finish evaluating instead of breeding whole generations (GA only; excludes the surrogate, fidelity schedules and views).
+@property (nonatomic) int workerLimit; //If > 0, at most this many of a generation's evaluations run at once.
+#ifdef __cplusplus
+@property (nonatomic) PerformanceCounters* performanceCounters; //Not owned; if set, receives time and hardware counts per phase (domain strip workers aren't measured).
+#endif
+
+@property (nonatomic) int pheromoneModel; //How pheromones are stored and sampled (see Constants.h).
+@property (nonatomic) int pheromoneUpdateInterval; //Ticks between decay/diffusion passes of the pheromone field.
+@property (nonatomic) float pheromoneDiffusionRate; //Fraction of each field cell's pheromone spread to its neighbors per pass.
 
 @property (nonatomic) float distributionRandom;
 @property (nonatomic) float distributionPowerlaw;
@@ -74,6 +125,8 @@
 @property (nonatomic) int pileRadius;
 @property (nonatomic) int numberOfClusteredPiles;
 
+@property (nonatomic) int optimizer; //How each generation is bred from the last (see Constants.h); the GA settings below only apply to GA.
+
 @property (nonatomic) float crossoverRate;
 @property (nonatomic) float mutationRate;
 @property (nonatomic) int selectionOperator;
@@ -85,9 +138,21 @@
 @property (nonatomic) NSPoint nest;
 
 @property (nonatomic) NSString* parameterFile;
+@property (nonatomic) NSString* traceDirectory; //If set, every post-evaluation is recorded there as a trace (see Trace.h).
+
+@property (nonatomic) BOOL useFitnessCache;
+@property (nonatomic) NSString* fitnessCacheFile; //Optional; persists the fitness cache across runs.
+@property (readonly, nonatomic) FitnessCache* fitnessCache;
+
+@property (nonatomic) BOOL useSurrogate; //Screen children with a fitness model before simulating them (generational GA only).
+@property (nonatomic) float surrogateSimulatedFraction; //Fraction of each generation, best predicted first, that is still simulated.
+@property (readonly, nonatomic) FitnessSurrogate* surrogate;
 
 @property (nonatomic) NSObject* delegate;
 @property (nonatomic) NSObject* viewDelegate;
-@property (nonatomic) float tickRate;
+@property (nonatomic) float tickRate; //Seconds to sleep after every tick; only used by the object-based view callback.
+@property (nonatomic) int frameInterval; //Ticks between frame snapshots for updateDisplayWindowWithFrame:.
+@property (nonatomic) float frameRate; //Maximum frames per second handed to updateDisplayWindowWithFrame: and frame stream clients.
+@property (nonatomic) NSString* frameStreamAddress; //"unix:/path" or "tcp:port" (loopback only) to stream frames to (see FrameServer.h); nil for none.
 
 @end
\ No newline at end of file
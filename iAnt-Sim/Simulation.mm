@@ -1,30 +1,108 @@
 #import <Cocoa/Cocoa.h>
 #import <dispatch/dispatch.h>
+#import <unordered_map>
 #import "Simulation.h"
+#import "StateTransition.h"
 
 using namespace std;
 using namespace cv;
 
-@interface Simulation()
+/*
+ * Everything one team needs of its own while evaluateTeamsInLockstep: runs a batch of teams on one world.
+ */
+struct LockstepTeam {
+    Team* team;
+    NSMutableArray* robots;
+    NSMutableArray* clusters;
+    NeighborGrid* neighborGrid;
+    TagBoard tagBoard;
+    vector<uint64_t> exploredBits; //The team's own explored flags, as the cells' are shared.
+    vector<uint64_t> randomStates; //The team's own per-robot random streams.
+    vector<PheromoneRecord> pheromones;
+    PheromoneField pheromoneField;
+    vector<NSPoint> collectedTags;
+    TransitionContext context;
+    BOOL clustered;
+    BOOL finished;
+};
 
--(void) setAverageTeamFrom:(NSMutableArray*)teams;
--(void) setBestTeamFrom:(NSMutableArray*)teams;
+@interface Simulation() {
+    vector<float> genomeBuffer; //Gene-major genomes of the current population (see setStatisticsFrom:).
+    vector<float> fitnessBuffer;
+    vector<float> statisticsScratch;
+    
+    TransitionKernel transitionKernel; //Specialized for the feature flags at the start of run.
+    int transitionKernelKey; //Behavior and feature flags transitionKernel was picked for.
+    NestField* nestField; //nil for worlds above NEST_FIELD_MAX_CELLS.
+    CMAES* cmaes; //Breeds generations instead of ga when optimizer is CMAESOptimizerId.
+    FrameBuffer* frameBuffer; //Snapshots for the view and frameServer, NULL if neither takes frames.
+    dispatch_source_t frameTimer; //Hands the newest frame to the view and frameServer on their own queue.
+    FrameServer* frameServer; //Streams frames to frameStreamAddress; NULL if not set.
+    dispatch_source_t frameListener; //Accepts frameServer clients.
+    BOOL viewTakesFrames; //The view implements updateDisplayWindowWithFrame: and gets frames instead of the object-based callback.
+    std::atomic<bool> framePublisherClaimed; //Set while one team publishes frames; concurrent evaluations would otherwise all write the back frame.
+    vector<int64_t> frameExploredCells; //Cells explored so far by the publishing team, in order (see publishFrameForTeam:).
+    std::mutex frameExploredCellsLock;
+    uint64_t frameEvaluation; //Counts evaluations that published frames, so frames know when to clear their explored bits.
+    EventPipeline* events; //Delivers tick, pickup and pheromone events while evaluations run; NULL otherwise.
+    TraceWriter* activeTrace; //Records the evaluation in progress if set; forces single-threaded, team-by-team evaluation.
+    TagBoard wrapperTagBoard; //Tags of wrapperTagBoardGrid for stateTransition:..., kept in step by the kernel's pickups.
+    TiledGrid wrapperTagBoardGrid; //Empty until stateTransition:... first runs.
+    uint64_t wrapperTagBoardLayout; //wrapperTagBoardGrid's layoutCount when wrapperTagBoard was built.
+    vector<vector<Cell*>> viewGrid; //Dense copy of viewGridSource for views that only take the dense grid.
+    TiledGrid viewGridSource;
+    uint64_t viewGridReleaseCount; //viewGridSource's releaseCount when viewGrid was built.
+}
+
+-(void) setStatisticsFrom:(NSMutableArray*)teams;
+-(int) evolveSteadyState:(NSMutableArray*)teams;
+-(int) evaluateSteadyStateTeam:(Team*)team onGrid:(TiledGrid&)grid cacheQueue:(dispatch_queue_t)cacheQueue;
+-(void) reportSteadyStateGeneration:(int)generation atEvaluation:(int)evaluation withTeams:(NSMutableArray*)teams;
+-(void) getFidelityForGeneration:(int)generation tickCount:(int*)stageTickCount evaluationCount:(int*)stageEvaluationCount;
+-(void) evaluateTeams:(NSMutableArray*)teams onGrid:(TiledGrid)grid forTicks:(int)ticks;
+-(void) screenTeams:(NSMutableArray*)teams withPredictions:(vector<float>&)predictions;
+-(void) evaluateTeamsInLockstep:(NSMutableArray*)teams onGrid:(TiledGrid&)grid forTicks:(int)ticks;
+-(void) resetGrid:(TiledGrid&)grid;
+-(vector<vector<Cell*>>&) viewGridFor:(TiledGrid&)grid;
+-(void) updatePheromoneField:(PheromoneField&)field forTeam:(Team*)team atTick:(int)tick;
+-(int) transitionInStrips:(NSMutableArray*)strips ofHeight:(int)stripHeight withRobots:(NSMutableArray*)robots context:(TransitionContext&)context
+                   atTick:(int)tick onGrid:(TiledGrid&)grid withPheromones:(vector<PheromoneRecord>&)pheromones
+                 clusters:(NSMutableArray*)clusters andCollectedTags:(vector<NSPoint>&)collectedTags;
+-(void) setClusters:(NSMutableArray*)clusters fromCollectedTags:(vector<NSPoint>&)collectedTags;
+-(void) selectTransitionKernel;
+-(void) prepareNestField;
+-(TransitionContext) transitionContextForTeam:(Team*)team;
+-(BOOL) startEvents;
+-(void) stopEvents;
+-(void) pushTickEvent:(int)tick remainingTags:(int)remainingTags;
+-(BOOL) startFrames;
+-(void) stopFrames;
+-(void) publishFrameForTeam:(Team*)team atTick:(int)tick onGrid:(TiledGrid&)grid withRobots:(NSMutableArray*)robots tagBoard:(const TagBoard&)tagBoard tagPositions:(const vector<NSPoint>&)tagPositions
+                 pheromones:(const vector<PheromoneRecord>&)pheromones pheromoneField:(const PheromoneField*)pheromoneField clusters:(NSMutableArray*)clusters;
 
 @end
 
 @implementation Simulation
 
-@synthesize teamCount, generationCount, robotCount, tagCount, evaluationCount, evaluationLimit, postEvaluations, tickCount, clusteringTagCutoff;
+@synthesize teamCount, generationCount, robotCount, tagCount, evaluationCount, evaluationLimit, postEvaluations, keepPostEvaluationSamples, tickCount, clusteringTagCutoff, seed;
+@synthesize fidelitySchedule, simulatedTickBudget, nominalTickBudget;
+@synthesize behavior;
 @synthesize useTravel, useGiveUp, useSiteFidelity, usePheromone, useInformedWalk;
+@synthesize useNeighborAvoidance, neighborRadius;
+@synthesize useLockstep, domainStripCount, useSteadyState, workerLimit, performanceCounters;
+@synthesize pheromoneModel, pheromoneUpdateInterval, pheromoneDiffusionRate;
 @synthesize distributionRandom, distributionPowerlaw, distributionClustered;
-@synthesize averageTeam, bestTeam;
+@synthesize averageTeam, bestTeam, statistics, memoryReport, barrierTiming;
 @synthesize pileRadius, numberOfClusteredPiles;
+@synthesize optimizer;
 @synthesize crossoverRate, mutationRate, selectionOperator, crossoverOperator, mutationOperator, elitism;
 @synthesize gridSize, nest;
-@synthesize parameterFile;
+@synthesize parameterFile, traceDirectory;
+@synthesize useFitnessCache, fitnessCacheFile, fitnessCache;
+@synthesize useSurrogate, surrogateSimulatedFraction, surrogate;
 @synthesize error, observedError;
 @synthesize delegate, viewDelegate;
-@synthesize tickRate;
+@synthesize tickRate, frameInterval, frameRate, frameStreamAddress;
 
 -(id) init {
     if(self = [super init]) {
@@ -35,8 +113,14 @@ using namespace cv;
         evaluationCount = 8;
         evaluationLimit = -1;
         postEvaluations = 1000;
+        keepPostEvaluationSamples = NO;
         tickCount = 7200;
         clusteringTagCutoff = -1;
+        seed = 0;
+        
+        fidelitySchedule = nil;
+        
+        behavior = CPFABehaviorId;
         
         useTravel =
         useGiveUp =
@@ -44,6 +128,19 @@ using namespace cv;
         usePheromone =
         useInformedWalk = YES;
         
+        useNeighborAvoidance = NO;
+        neighborRadius = 2;
+        
+        useLockstep = NO;
+        domainStripCount = 0;
+        useSteadyState = NO;
+        workerLimit = 0;
+        performanceCounters = NULL;
+        
+        pheromoneModel = PheromoneRecordsModelId;
+        pheromoneUpdateInterval = 10;
+        pheromoneDiffusionRate = 0.;
+        
         distributionClustered = 1.;
         distributionPowerlaw = 0.;
         distributionRandom = 0.;
@@ -51,6 +148,8 @@ using namespace cv;
         pileRadius = 2;
         numberOfClusteredPiles = 4;
         
+        optimizer = GAOptimizerId;
+        
         crossoverRate = 1.0;
         mutationRate = 0.1;
         selectionOperator  = TournamentSelectionId;
@@ -62,6 +161,22 @@ using namespace cv;
         nest = NSMakePoint(62, 62);
         
         parameterFile = nil;
+        traceDirectory = nil;
+        activeTrace = NULL;
+        events = NULL;
+        frameBuffer = NULL;
+        frameServer = NULL;
+        frameStreamAddress = nil;
+        viewTakesFrames = NO;
+        framePublisherClaimed = false;
+        frameInterval = 1;
+        frameRate = 60.;
+        
+        useFitnessCache = NO;
+        fitnessCacheFile = nil;
+        
+        useSurrogate = NO;
+        surrogateSimulatedFraction = 0.5;
         
         observedError = YES;
     }
@@ -73,7 +188,37 @@ using namespace cv;
  */
 -(NSMutableDictionary*) run {
     
-    srandomdev(); //Seed random number generator.
+    //The neighbor radius is also the bucket size of the neighbor grid.
+    if(useNeighborAvoidance && neighborRadius <= 0) {
+        [NSException raise:@"Invalid neighbor radius" format:@"neighborRadius must be positive, not %d", neighborRadius];
+    }
+    
+    //Strips only see their own robots, so neighbors across a strip boundary would go unnoticed,
+    //and the view expects one robot array per tick.
+    if((domainStripCount > 1) && (useNeighborAvoidance || viewDelegate)) {
+        [NSException raise:@"Invalid domain strip count" format:@"domainStripCount %d can't be combined with %@", domainStripCount,
+         useNeighborAvoidance ? @"useNeighborAvoidance" : @"a view delegate"];
+    }
+    
+    //Lockstep runs every team of a batch on one world, which can't also be cut into strips.
+    if(useLockstep && (domainStripCount > 1)) {
+        [NSException raise:@"Invalid domain strip count" format:@"domainStripCount %d can't be combined with useLockstep", domainStripCount];
+    }
+    
+    //Steady state breeds one GA child at a time at full fidelity, and nothing about it can be shown in a view.
+    if(useSteadyState && ((optimizer == CMAESOptimizerId) || useSurrogate || [fidelitySchedule count] || viewDelegate)) {
+        [NSException raise:@"Invalid steady state" format:@"useSteadyState can't be combined with %@",
+         (optimizer == CMAESOptimizerId) ? @"the CMA-ES optimizer" : useSurrogate ? @"useSurrogate" :
+         [fidelitySchedule count] ? @"a fidelity schedule" : @"a view delegate"];
+    }
+    
+    //Seed random number generator.
+    if(seed) {
+        srandom(seed);
+    }
+    else {
+        srandomdev();
+    }
     
     //Allocate teams and initialize parameters accordingly
     NSMutableArray* teams = [[NSMutableArray alloc] initWithCapacity:teamCount];
@@ -95,8 +240,7 @@ using namespace cv;
     }
     
     //Initialize average and best teams
-    [self setAverageTeamFrom:teams];
-    [self setBestTeamFrom:teams];
+    [self setStatisticsFrom:teams];
     
     //If evaluationLimit is -1, make sure it does not factor into these calculations.
     if(evaluationLimit == -1){
@@ -111,128 +255,657 @@ using namespace cv;
     
     //Set up GA
     ga = [[GA alloc] initWithElitism:elitism selectionOperator:selectionOperator crossoverRate:crossoverRate crossoverOperator:crossoverOperator mutationRate:mutationRate andMutationOperator:mutationOperator];
+    cmaes = (optimizer == CMAESOptimizerId) ? [[CMAES alloc] init] : nil;
+    
+    //Set up fitness cache
+    if(useFitnessCache) {
+        if(fitnessCacheFile) {
+            fitnessCache = [[FitnessCache alloc] initWithFile:fitnessCacheFile andConfigurationHash:[self configurationHash]];
+        }
+        else {
+            fitnessCache = [[FitnessCache alloc] initWithConfigurationHash:[self configurationHash]];
+        }
+    }
+    else {
+        fitnessCache = nil;
+    }
+    
+    //Set up surrogate fitness model
+    surrogate = useSurrogate ? [[FitnessSurrogate alloc] initWithCapacity:teamCount * 10] : nil;
+    
+    [self selectTransitionKernel];
+    [self prepareNestField];
     
     //Set evaluation count to 1 if using GUI
     evaluationCount = (viewDelegate != nil) ? 1 : evaluationCount;
     
     //Not the number of evaluations to perform on each individual, but a count of the total number of evaluations performed so far during this run.
     int evalCount = 0;
+    simulatedTickBudget = nominalTickBudget = 0;
+    memset(&barrierTiming, 0, sizeof(barrierTiming));
     
-    //Allocate and initialize cellular grids
-    vector<vector<vector<Cell*>>> grids;
+    //Allocate cellular grids (cells themselves are allocated a tile at a time as they are touched)
+    vector<TiledGrid> grids;
     for (int i = 0; i < evaluationCount; i++) {
-        vector<vector<Cell*>> grid;
-        grid.resize(gridSize.height);
-        for (int i = 0; i < gridSize.height; i++) {
-            grid[i].resize(gridSize.width);
-            for (int j = 0; j < gridSize.width; j++) {
-                grid[i][j] = [[Cell alloc] init];
-            }
-        }
-        grids.push_back(grid);
+        grids.push_back(TiledGrid(gridSize.width, gridSize.height));
     }
     
     if(delegate && [delegate respondsToSelector:@selector(simulationDidStart:)]) {
         [delegate simulationDidStart:self];
     }
     
+    [self startEvents];
+    [self startFrames];
+    
     //Main loop
-    for(int generation = 0; generation < generationCount && evalCount < evaluationLimit; generation++) {
-        for(Team* team in teams) {
-            [team setFitness:0.];
-            [team setTimeToCompleteCollection:0.];
-        }
-        
-        if (evaluationCount > 1) {
-            dispatch_queue_t queue = dispatch_get_global_queue(0, 0);
-            dispatch_apply(evaluationCount, queue, ^(size_t iteration) {
-                [self evaluateTeams:teams onGrid:grids[iteration]];
-            });
-        }
-        else {
-            [self evaluateTeams:teams onGrid:grids[0]];
-        }
-        
-        //Number of evaluations performed is the number of teams times the number of evaluations per team.
-        evalCount = evalCount + teamCount*evaluationCount;
-        
-        //Set average and best teams
-        [self setAverageTeamFrom:teams];
-        [self setBestTeamFrom:teams];
-        
-        @autoreleasepool {
-            [ga breedPopulation:teams AtGeneration:generation andMaxGeneration:generationCount];
+    if(useSteadyState) {
+        evalCount = [self evolveSteadyState:teams];
+    }
+    else {
+        for(int generation = 0; generation < generationCount && evalCount < evaluationLimit; generation++) {
+            //Generations covered by fidelitySchedule run with fewer ticks and evaluations than configured.
+            int stageTickCount, stageEvaluationCount;
+            [self getFidelityForGeneration:generation tickCount:&stageTickCount evaluationCount:&stageEvaluationCount];
+            //Reduced-fidelity fitness is only comparable within its generation, so keep it out of the cache and surrogate.
+            BOOL fullFidelity = (stageTickCount == tickCount) && (stageEvaluationCount == evaluationCount);
+            
+            //Work out how many evaluations each team still needs.
+            //Genomes found in the fitness cache only get top-up evaluations (if any).
+            vector<int> cachedSamples(teamCount, 0);
+            vector<float> cachedFitness(teamCount, 0.f);
+            vector<float> cachedTime(teamCount, 0.f);
+            NSMutableArray* pendingTeams = [[NSMutableArray alloc] initWithCapacity:stageEvaluationCount];
+            for(int i = 0; i < stageEvaluationCount; i++) {
+                [pendingTeams addObject:[[NSMutableArray alloc] initWithCapacity:teamCount]];
+            }
+            
+            //Children the surrogate ranks among the weakest keep its prediction instead of being simulated (-1 = simulate).
+            vector<float> predictions(teamCount, -1.f);
+            if(surrogate && [surrogate trained] && fullFidelity) {
+                [self screenTeams:teams withPredictions:predictions];
+            }
+            
+            //With the fitness cache, identical genomes (elites, unmutated copies) are only simulated once and the others
+            //copy the result, just as they would share the cached samples (-1 = simulate).
+            //Without it every team is evaluated independently, so duplicates keep their own noisy samples.
+            vector<int> duplicateOf(teamCount, -1);
+            vector<float> genomes(fitnessCache ? teamCount * TEAM_PARAMETER_COUNT : 0);
+            unordered_map<uint64_t, int> firstWithGenome;
+            for(int t = 0; fitnessCache && (t < teamCount); t++) {
+                float* genome = &genomes[t * TEAM_PARAMETER_COUNT];
+                [[teams objectAtIndex:t] getGenome:genome];
+                auto found = firstWithGenome.emplace(hashBytes(genome, TEAM_PARAMETER_COUNT * sizeof(float), FNV_OFFSET_BASIS), t).first;
+                if(found->second != t && !memcmp(&genomes[found->second * TEAM_PARAMETER_COUNT], genome, TEAM_PARAMETER_COUNT * sizeof(float))) {
+                    duplicateOf[t] = found->second;
+                }
+            }
+            
+            int pendingEvaluations = 0;
+            float genome[TEAM_PARAMETER_COUNT];
+            for(int t = 0; t < teamCount; t++) {
+                Team* team = [teams objectAtIndex:t];
+                [team setFitness:0.];
+                [team setTimeToCompleteCollection:0.];
+                [team setScreened:NO];
+                
+                if(duplicateOf[t] >= 0) {
+                    predictions[t] = -1.f;
+                    continue;
+                }
+                
+                if(fitnessCache && fullFidelity) {
+                    [team getGenome:genome];
+                    cachedSamples[t] = [fitnessCache samplesForGenome:genome meanFitness:&cachedFitness[t] meanTimeToCompleteCollection:&cachedTime[t]];
+                }
+                
+                //Cached samples beat a prediction, so only screen genomes the cache has never seen.
+                if(predictions[t] >= 0.f && !cachedSamples[t]) {
+                    [team setFitness:predictions[t] * stageEvaluationCount];
+                    [team setScreened:YES];
+                    [surrogate setScreenedCount:[surrogate screenedCount] + 1];
+                    continue;
+                }
+                predictions[t] = -1.f;
+                
+                for(int i = 0; i < stageEvaluationCount - cachedSamples[t]; i++) {
+                    [[pendingTeams objectAtIndex:i] addObject:team];
+                    pendingEvaluations++;
+                }
+            }
+            
+            //Workers take evaluations in turn, so workerLimit bounds how many run at once.
+            //Each records the time it spends evaluating; the rest of the barrier's span it sits idle.
+            int workerCount = (workerLimit > 0) ? MIN(workerLimit, stageEvaluationCount) : stageEvaluationCount;
+            atomic<int> nextEvaluation(0);
+            atomic<int>* next = &nextEvaluation;
+            vector<double> busySeconds(workerCount, 0.);
+            double* busy = busySeconds.data();
+            double barrierStart = monotonicSeconds();
+            if (stageEvaluationCount > 1) {
+                dispatch_queue_t queue = dispatch_get_global_queue(0, 0);
+                dispatch_apply(workerCount, queue, ^(size_t worker) {
+                    for(int iteration = next->fetch_add(1); iteration < stageEvaluationCount; iteration = next->fetch_add(1)) {
+                        //Workers don't drain the caller's pool, so give each its own.
+                        @autoreleasepool {
+                            if([[pendingTeams objectAtIndex:iteration] count]) {
+                                double start = monotonicSeconds();
+                                [self evaluateTeams:[pendingTeams objectAtIndex:iteration] onGrid:grids[iteration] forTicks:stageTickCount];
+                                busy[worker] += monotonicSeconds() - start;
+                            }
+                        }
+                    }
+                });
+            }
+            else if([[pendingTeams objectAtIndex:0] count]) {
+                [self evaluateTeams:[pendingTeams objectAtIndex:0] onGrid:grids[0] forTicks:stageTickCount];
+                busy[0] = monotonicSeconds() - barrierStart;
+            }
+            double barrierSeconds = monotonicSeconds() - barrierStart;
+            barrierTiming.wallSeconds += barrierSeconds;
+            for(double seconds : busySeconds) {
+                barrierTiming.busySeconds += seconds;
+                barrierTiming.idleSeconds += barrierSeconds - seconds;
+            }
+            barrierTiming.workers = MAX(barrierTiming.workers, workerCount);
+            barrierTiming.barriers++;
+            barrierTiming.evaluations += pendingEvaluations;
+            
+            //Merge new samples with cached ones; fitness stays a sum over stageEvaluationCount evaluations.
+            if(fitnessCache && fullFidelity) {
+                for(int t = 0; t < teamCount; t++) {
+                    Team* team = [teams objectAtIndex:t];
+                    if((predictions[t] >= 0.f) || (duplicateOf[t] >= 0)) {
+                        continue;
+                    }
+                    [team getGenome:genome];
+                    int newSamples = MAX(stageEvaluationCount - cachedSamples[t], 0);
+                    float newFitness = [team fitness];
+                    int newTime = [team timeToCompleteCollection];
+                    if(cachedSamples[t]) {
+                        float mean = ((cachedFitness[t] * cachedSamples[t]) + newFitness) / (cachedSamples[t] + newSamples);
+                        [team setFitness:mean * stageEvaluationCount];
+                        float time = ((cachedTime[t] * cachedSamples[t]) + ((float)newTime * newSamples)) / (cachedSamples[t] + newSamples);
+                        [team setTimeToCompleteCollection:(int)roundf(time)];
+                    }
+                    [fitnessCache addSamples:newSamples withFitnessSum:newFitness timeToCompleteCollection:newTime forGenome:genome];
+                }
+            }
+            
+            //Only evaluations that were actually simulated count towards the evaluation limit.
+            evalCount = evalCount + pendingEvaluations;
+            simulatedTickBudget += (long long)pendingEvaluations * stageTickCount;
+            nominalTickBudget += (long long)teamCount * evaluationCount * tickCount;
+            
+            //Teach the surrogate everything that was measured this generation.
+            if(surrogate && fullFidelity) {
+                for(int t = 0; t < teamCount; t++) {
+                    if((predictions[t] < 0.f) && (duplicateOf[t] < 0)) {
+                        Team* team = [teams objectAtIndex:t];
+                        [team getGenome:genome];
+                        [surrogate addGenome:genome withFitness:[team fitness] / stageEvaluationCount];
+                    }
+                }
+                [surrogate train];
+            }
+            
+            for(int t = 0; fitnessCache && (t < teamCount); t++) {
+                if(duplicateOf[t] >= 0) {
+                    Team* team = [teams objectAtIndex:t];
+                    Team* original = [teams objectAtIndex:duplicateOf[t]];
+                    [team setFitness:[original fitness]];
+                    [team setTimeToCompleteCollection:[original timeToCompleteCollection]];
+                    [team setPredictedClusters:[original predictedClusters]];
+                    [team setScreened:[original screened]];
+                }
+            }
+            
+            //Reduced-fidelity fitness is summed over fewer evaluations; scale it to the configured count like all other fitness.
+            if(stageEvaluationCount != evaluationCount) {
+                for(Team* team in teams) {
+                    [team setFitness:[team fitness] * evaluationCount / stageEvaluationCount];
+                }
+            }
+            
+            //Set average and best teams
+            [self setStatisticsFrom:teams];
+            
+            @autoreleasepool {
+                PerformanceScope breedingScope(performanceCounters, PerformancePhaseBreeding);
+                if(cmaes) {
+                    [cmaes breedPopulation:teams AtGeneration:generation andMaxGeneration:generationCount];
+                }
+                else {
+                    [ga breedPopulation:teams AtGeneration:generation andMaxGeneration:generationCount];
+                }
+            }
+            
+            memoryReport = [MemoryMonitor currentReport];
+            if(delegate && [delegate respondsToSelector:@selector(simulation:didReportMemory:atGeneration:)]) {
+                [delegate simulation:self didReportMemory:memoryReport atGeneration:generation];
+            }
+            
+            if(events) {
+                events->flush();
+            }
+            if(delegate && [delegate respondsToSelector:@selector(simulation:didFinishGeneration:atEvaluation:)]) {
+                [delegate simulation:self didFinishGeneration:generation atEvaluation:evalCount];
+            }
         }
         
-        if(delegate && [delegate respondsToSelector:@selector(simulation:didFinishGeneration:atEvaluation:)]) {
-            [delegate simulation:self didFinishGeneration:generation atEvaluation:evalCount];
+        if(fidelitySchedule) {
+            printf("Multi-fidelity schedule simulated %lld of %lld ticks (%.1f%%)\n", simulatedTickBudget, nominalTickBudget,
+                   nominalTickBudget ? 100. * simulatedTickBudget / nominalTickBudget : 0.);
         }
     }
     
+    if(events) {
+        events->flush();
+    }
     if(delegate && [delegate respondsToSelector:@selector(simulationDidFinish:)]) {
         [delegate simulationDidFinish:self];
     }
     
+    if(fitnessCache && fitnessCacheFile) {
+        [fitnessCache writeToFile:fitnessCacheFile];
+    }
+    
     printf("Completed\n");
     
     //Return an evaluation of the average team from the final generation
-    return [self evaluateTeam:averageTeam onGrid:grids[0]];
+    NSMutableDictionary* results = [self evaluateTeam:averageTeam onGrid:grids[0]];
+    [self stopEvents];
+    [self stopFrames];
+    return results;
 }
 
 
+/*
+ * Gets the tick and evaluation counts generation runs with, from the first fidelitySchedule stage that covers it,
+ * or tickCount and evaluationCount if none does. The properties themselves are never changed.
+ */
+-(void) getFidelityForGeneration:(int)generation tickCount:(int*)stageTickCount evaluationCount:(int*)stageEvaluationCount {
+    *stageTickCount = tickCount;
+    *stageEvaluationCount = evaluationCount;
+    for(NSDictionary* stage in fidelitySchedule) {
+        if(generation < [[stage objectForKey:@"untilGeneration"] intValue]) {
+            if([stage objectForKey:@"tickFraction"]) {
+                *stageTickCount = MAX((int)roundf(tickCount * [[stage objectForKey:@"tickFraction"] floatValue]), 1);
+            }
+            if([stage objectForKey:@"evaluationFraction"]) {
+                *stageEvaluationCount = MIN(MAX((int)roundf(evaluationCount * [[stage objectForKey:@"evaluationFraction"] floatValue]), 1), evaluationCount);
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * Ranks teams by the surrogate's predicted fitness and marks all but the best surrogateSimulatedFraction of them
+ * as screened, storing their predicted per-evaluation fitness in predictions (others are left at -1).
+ */
+-(void) screenTeams:(NSMutableArray*)teams withPredictions:(vector<float>&)predictions {
+    int count = (int)[teams count];
+    vector<float> predicted(count);
+    vector<int> order(count);
+    float genome[TEAM_PARAMETER_COUNT];
+    for(int t = 0; t < count; t++) {
+        [[teams objectAtIndex:t] getGenome:genome];
+        predicted[t] = MAX([surrogate predictFitnessForGenome:genome], 0.f);
+        order[t] = t;
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) {return predicted[a] > predicted[b];});
+    
+    int simulatedCount = MAX((int)ceilf(count * surrogateSimulatedFraction), 1);
+    for(int i = simulatedCount; i < count; i++) {
+        predictions[order[i]] = predicted[order[i]];
+    }
+}
+
+/*
+ * Steady-state alternative to the generational loop of run, so no core waits at a generation barrier.
+ * After the initial population is evaluated, one worker per core repeatedly breeds a single child from the current population,
+ * evaluates it on its own grid and lets it replace the worst team if it is at least as fit.
+ * Breeding and replacement are serialized on a queue; only the simulation runs concurrently.
+ * The initial population counts as generation 0, and every teamCount children after it as one more generation,
+ * both for the evaluation budget and for statistics and delegate callbacks.
+ * Workers only queue a snapshot of the population at the end of a generation; the statistics and delegate callbacks
+ * run on the calling thread, as they do in the generational loop.
+ * At most workerLimit (if set) evaluations run at once, and genomes in the fitness cache only get top-up evaluations.
+ * Only simulated evaluations count towards the budget, and no more than generationCount generations are bred.
+ * Returns the number of evaluations performed.
+ */
+-(int) evolveSteadyState:(NSMutableArray*)teams {
+    int evaluationBudget = (int)MIN((long long)evaluationLimit, (long long)generationCount * teamCount * evaluationCount);
+    int childLimit = MAX(generationCount - 1, 0) * teamCount;
+    dispatch_queue_t populationQueue = dispatch_queue_create("iAnt-Sim.population", DISPATCH_QUEUE_SERIAL);
+    int workerCount = (workerLimit > 0) ? workerLimit : MAX((int)[[NSProcessInfo processInfo] activeProcessorCount], 1);
+    
+    //Evaluate the initial population, workers taking teams in turn.
+    atomic<int> nextTeam(0), initialEvaluations(0);
+    atomic<int>* next = &nextTeam;
+    atomic<int>* initial = &initialEvaluations;
+    dispatch_apply(MIN(workerCount, teamCount), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t worker) {
+        TiledGrid grid(gridSize.width, gridSize.height);
+        for(int t = next->fetch_add(1); t < teamCount; t = next->fetch_add(1)) {
+            @autoreleasepool {
+                *initial += [self evaluateSteadyStateTeam:[teams objectAtIndex:t] onGrid:grid cacheQueue:populationQueue];
+            }
+        }
+    });
+    
+    __block int evalCount = initialEvaluations;
+    __block int reservedEvaluations = evalCount; //Includes evaluations of children still being simulated.
+    __block int bredCount = 0;
+    __block int childCount = 0;
+    [self reportSteadyStateGeneration:0 atEvaluation:evalCount withTeams:teams];
+    __block int generation = 1;
+    
+    //Generations finished by the workers, waiting to be reported on this thread (guarded by populationQueue).
+    NSMutableArray* reports = [[NSMutableArray alloc] init];
+    dispatch_semaphore_t reportReady = dispatch_semaphore_create(0);
+    
+    dispatch_block_t work = ^{
+        TiledGrid grid(gridSize.width, gridSize.height);
+        
+        while(YES) {
+            @autoreleasepool {
+                __block Team* child = nil;
+                dispatch_sync(populationQueue, ^{
+                    if((reservedEvaluations + evaluationCount <= evaluationBudget) && (bredCount < childLimit)) {
+                        reservedEvaluations += evaluationCount;
+                        bredCount++;
+                        NSArray* population = [teams sortedArrayUsingComparator:^NSComparisonResult(id objA, id objB) {
+                            return [@([objA fitness]) compare:@([objB fitness])];
+                        }];
+                        PerformanceScope breedingScope(performanceCounters, PerformancePhaseBreeding);
+                        child = [[Team alloc] init];
+                        [ga breedChild:child fromPopulation:population atGeneration:generation andMaxGeneration:generationCount];
+                    }
+                });
+                if(!child) {
+                    break;
+                }
+                
+                int simulated = [self evaluateSteadyStateTeam:child onGrid:grid cacheQueue:populationQueue];
+                
+                dispatch_sync(populationQueue, ^{
+                    evalCount += simulated;
+                    reservedEvaluations -= evaluationCount - simulated; //Cached samples cost nothing.
+                    
+                    //Replace the worst team
+                    Team* worst = [teams objectAtIndex:0];
+                    for(Team* team in teams) {
+                        if([team fitness] < [worst fitness]) {
+                            worst = team;
+                        }
+                    }
+                    if([child fitness] >= [worst fitness]) {
+                        [worst setParameters:[child getParameters]];
+                        [worst setFitness:[child fitness]];
+                        [worst setTimeToCompleteCollection:[child timeToCompleteCollection]];
+                        [worst setPredictedClusters:[child predictedClusters]];
+                    }
+                    
+                    if(++childCount % teamCount == 0) {
+                        //Later replacements must not show up in this generation's report, so it gets copies.
+                        NSMutableArray* snapshot = [[NSMutableArray alloc] initWithCapacity:teamCount];
+                        float genome[TEAM_PARAMETER_COUNT];
+                        for(Team* team in teams) {
+                            Team* copy = [[Team alloc] init];
+                            [team getGenome:genome];
+                            [copy setGenome:genome];
+                            [copy setFitness:[team fitness]];
+                            [snapshot addObject:copy];
+                        }
+                        [reports addObject:@{@"generation" : @(generation), @"evaluations" : @(evalCount), @"teams" : snapshot}];
+                        dispatch_semaphore_signal(reportReady);
+                        generation++;
+                    }
+                });
+            }
+        }
+    };
+    dispatch_group_t workers = dispatch_group_create();
+    for(int worker = 0; worker < workerCount; worker++) {
+        dispatch_group_async(workers, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), work);
+    }
+    dispatch_group_notify(workers, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        dispatch_semaphore_signal(reportReady);
+    });
+    
+    //Deliver reports here until the workers are done; once they are, every report has been queued.
+    BOOL finished = NO;
+    while(!finished) {
+        dispatch_semaphore_wait(reportReady, DISPATCH_TIME_FOREVER);
+        finished = (dispatch_group_wait(workers, DISPATCH_TIME_NOW) == 0);
+        __block NSArray* pending;
+        dispatch_sync(populationQueue, ^{
+            pending = [reports copy];
+            [reports removeAllObjects];
+        });
+        for(NSDictionary* report in pending) {
+            @autoreleasepool {
+                [self reportSteadyStateGeneration:[[report objectForKey:@"generation"] intValue]
+                                     atEvaluation:[[report objectForKey:@"evaluations"] intValue]
+                                        withTeams:[report objectForKey:@"teams"]];
+            }
+        }
+    }
+    
+    [self setStatisticsFrom:teams];
+    return evalCount;
+}
+
+/*
+ * Evaluates team evaluationCount times on grid for evolveSteadyState:, leaving its fitness summed over them.
+ * With a fitness cache, only the evaluations its genome lacks are simulated and the rest come from the cache,
+ * which is only accessed on cacheQueue. Returns the number of evaluations simulated.
+ */
+-(int) evaluateSteadyStateTeam:(Team*)team onGrid:(TiledGrid&)grid cacheQueue:(dispatch_queue_t)cacheQueue {
+    [team setFitness:0.];
+    [team setTimeToCompleteCollection:0.];
+    
+    float genome[TEAM_PARAMETER_COUNT];
+    float* genomePointer = genome; //Blocks can't capture arrays.
+    __block int cachedSamples = 0;
+    __block float cachedFitness = 0.f, cachedTime = 0.f;
+    if(fitnessCache) {
+        [team getGenome:genome];
+        dispatch_sync(cacheQueue, ^{
+            cachedSamples = [fitnessCache samplesForGenome:genomePointer meanFitness:&cachedFitness meanTimeToCompleteCollection:&cachedTime];
+        });
+    }
+    
+    int newSamples = MAX(evaluationCount - cachedSamples, 0);
+    NSMutableArray* batch = [[NSMutableArray alloc] initWithObjects:team, nil];
+    for(int i = 0; i < newSamples; i++) {
+        [self evaluateTeams:batch onGrid:grid];
+    }
+    
+    //Merge new samples with cached ones, as the generational loop does.
+    if(fitnessCache) {
+        float newFitness = [team fitness];
+        int newTime = [team timeToCompleteCollection];
+        if(cachedSamples) {
+            float mean = ((cachedFitness * cachedSamples) + newFitness) / (cachedSamples + newSamples);
+            [team setFitness:mean * evaluationCount];
+            float time = ((cachedTime * cachedSamples) + ((float)newTime * newSamples)) / (cachedSamples + newSamples);
+            [team setTimeToCompleteCollection:(int)roundf(time)];
+        }
+        dispatch_sync(cacheQueue, ^{
+            [fitnessCache addSamples:newSamples withFitnessSum:newFitness timeToCompleteCollection:newTime forGenome:genomePointer];
+        });
+    }
+    return newSamples;
+}
+
+/*
+ * Sets the statistics from teams and tells the delegate that generation of evolveSteadyState: is done.
+ */
+-(void) reportSteadyStateGeneration:(int)generation atEvaluation:(int)evaluation withTeams:(NSMutableArray*)teams {
+    [self setStatisticsFrom:teams];
+    
+    memoryReport = [MemoryMonitor currentReport];
+    if(delegate && [delegate respondsToSelector:@selector(simulation:didReportMemory:atGeneration:)]) {
+        [delegate simulation:self didReportMemory:memoryReport atGeneration:generation];
+    }
+    
+    if(events) {
+        events->flush();
+    }
+    if(delegate && [delegate respondsToSelector:@selector(simulation:didFinishGeneration:atEvaluation:)]) {
+        [delegate simulation:self didFinishGeneration:generation atEvaluation:evaluation];
+    }
+}
+
 /*
  * Run a single evaluation
  */
--(void) evaluateTeams:(NSMutableArray*)teams onGrid:(vector<vector<Cell*>>)grid{
+-(void) evaluateTeams:(NSMutableArray*)teams onGrid:(TiledGrid)grid{
+    [self evaluateTeams:teams onGrid:grid forTicks:tickCount];
+}
+
+/*
+ * Same as evaluateTeams:onGrid:, but runs ticks ticks (-1 for no limit) instead of tickCount.
+ */
+-(void) evaluateTeams:(NSMutableArray*)teams onGrid:(TiledGrid)grid forTicks:(int)ticks {
+    [self selectTransitionKernel];
+    
     [self initDistributionForArray:grid];
     
+    //Views and frames follow one team at a time, so they need the team-by-team loop.
+    if(useLockstep && (viewDelegate == nil) && !frameBuffer && !activeTrace && ([teams count] > 1)) {
+        [self evaluateTeamsInLockstep:teams onGrid:grid forTicks:ticks];
+        return;
+    }
+    
+    //Every team starts from the same tags; its working board is reset by copying.
+    TagBoard initialTagBoard, tagBoard;
+    tagBoardFromGrid(initialTagBoard, grid);
+    
+    //Frames list the tags still on the board out of these.
+    vector<NSPoint> tagPositions;
+    if(frameBuffer) {
+        grid.forEachCell([&tagPositions](Cell* cell, int x, int y) {
+            if([cell tag]) {
+                tagPositions.push_back(NSMakePoint(x, y));
+            }
+        });
+    }
+    
+    //Buffers are allocated once per call and reused by every team and tick.
     NSMutableArray* robots = [[NSMutableArray alloc] initWithCapacity:robotCount];
-    NSMutableArray* pheromones = [[NSMutableArray alloc] init];
     NSMutableArray* clusters = [[NSMutableArray alloc] init];
-    NSMutableArray* totalCollectedTags = [[NSMutableArray alloc] init];
-    for(int i = 0; i < robotCount; i++){[robots addObject:[[Robot alloc] init]];}
+    vector<PheromoneRecord> pheromones;
+    PheromoneField pheromoneField;
+    vector<NSPoint> totalCollectedTags;
+    pheromones.reserve(tagCount);
+    totalCollectedTags.reserve(tagCount);
+    for(int i = 0; i < robotCount; i++) {
+        Robot* robot = [[Robot alloc] init];
+        [robot setIndex:i];
+        [robots addObject:robot];
+    }
     
-    for(Team* team in teams) {
-        for (vector<Cell*> v : grid) {
-            for (Cell* cell : v) {
-                [cell setIsClustered:NO];
-                [cell setIsExplored:NO];
-                if([cell tag]) {
-                    [[cell tag] setDiscovered:NO];
-                    [[cell tag] setPickedUp:NO];
-                }
-            }
+    //Index robot positions so neighbor queries cost the same however large the swarm is.
+    NeighborGrid* neighborGrid = nil;
+    if(useNeighborAvoidance) {
+        neighborGrid = [[NeighborGrid alloc] initWithSize:gridSize bucketSize:neighborRadius andCapacity:robotCount];
+        for(Robot* robot in robots) {
+            [robot setNeighborGrid:neighborGrid];
         }
+    }
+    
+    //Split the world into strips run by separate workers (see transitionInStrips:).
+    //Strips are whole tile rows, at least two tiles high. run rejects strips with neighbor avoidance or a view;
+    //traced evaluations (see GoldenTrace.h) run in one piece because the trace records the kernel's order.
+    int stripHeight = 0;
+    NSMutableArray* strips = nil;
+    vector<uint64_t> randomStates;
+    if((domainStripCount > 1) && !useNeighborAvoidance && (viewDelegate == nil) && !activeTrace) {
+        int height = (int)gridSize.height;
+        stripHeight = MAX(((((height + domainStripCount - 1) / domainStripCount) + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE) * GRID_TILE_SIZE, 2 * GRID_TILE_SIZE);
+        strips = [[NSMutableArray alloc] init];
+        for(int i = 0; i < (height + stripHeight - 1) / stripHeight; i++) {
+            [strips addObject:[[NSMutableArray alloc] init]];
+        }
+        randomStates.resize(robotCount);
+    }
+    
+    for(Team* team in teams) {
+        [self resetGrid:grid];
         
         for(Robot* robot in robots) {
             [robot reset];
         }
         
-        [pheromones removeAllObjects];
-        [totalCollectedTags removeAllObjects];
+        pheromones.clear();
+        totalCollectedTags.clear();
+        tagBoard = initialTagBoard;
         BOOL clustered = NO;
+        TransitionContext context = [self transitionContextForTeam:team];
+        context.neighborGrid = neighborGrid;
+        context.tagBoard = &tagBoard;
+        context.trace = activeTrace;
+        //The field is sized to the world, so it is only worth its memory if robots follow it.
+        if((pheromoneModel == PheromoneFieldModelId) && usePheromone) {
+            pheromoneField.reset(gridSize.width, gridSize.height);
+            context.pheromoneField = &pheromoneField;
+        }
         
-        for(int tick = 0; tickCount >= 0 ? tick < tickCount : YES; tick++) {
+        //Every robot gets its own random stream, seeded from the shared one, so strips can run in any order.
+        if(strips) {
+            uint64_t seed = ((uint64_t)random() << 31) ^ random();
+            for(int i = 0; i < robotCount; i++) {
+                randomStates[i] = randomStateFromSeed(seed + i);
+            }
+            context.randomStates = randomStates.data();
+        }
+        
+        PerformanceScope tickScope(performanceCounters, PerformancePhaseTicks);
+        int ticksRun = 0;
+        
+        //Only one team at a time publishes; the others, running concurrently, are not shown.
+        bool publishesFrames = false;
+        if(frameBuffer) {
+            publishesFrames = framePublisherClaimed.compare_exchange_strong(publishesFrames, true);
+        }
+        if(publishesFrames) {
+            frameExploredCells.clear();
+            frameEvaluation++;
+            context.exploredCells = &frameExploredCells;
+            context.exploredCellsLock = &frameExploredCellsLock;
+        }
+        int nextFrameTick = 0;
+        
+        for(int tick = 0; ticks >= 0 ? tick < ticks : YES; tick++) {
+            ticksRun++;
             
-            NSMutableArray* collectedTags = [self stateTransition:robots inTeam:team atTick:tick onGrid:grid withPheromones:pheromones andClusters:clusters];
+            int collectedTags = strips ? [self transitionInStrips:strips ofHeight:stripHeight withRobots:robots context:context atTick:tick onGrid:grid withPheromones:pheromones clusters:clusters andCollectedTags:totalCollectedTags]
+                                       : transitionKernel(robots, context, tick, grid, pheromones, clusters, totalCollectedTags);
             
-            [team setFitness:[team fitness] + [collectedTags count]];
-            [totalCollectedTags addObjectsFromArray:collectedTags];
+            [team setFitness:[team fitness] + collectedTags];
             
-            if ((clusteringTagCutoff >= 0) && ([totalCollectedTags count] >= [self clusteringTagCutoff]) && !clustered) {
-                EM em = [Cluster trainOptimalEMWith:totalCollectedTags];
-                Mat means = em.get<Mat>("means");
-                vector<Mat> covs = em.get<vector<Mat>>("covs");
-                
-                [clusters removeAllObjects];
-                for(int i = 0; i < means.size().height; i++) {
-                    NSPoint p = NSMakePoint(round(means.at<double>(i,0)), round(means.at<double>(i,1)));
-                    double width = ceil(covs[i].at<double>(0,0));
-                    double height = ceil(covs[i].at<double>(1,1));
-                    Cluster* c = [[Cluster alloc] initWithCenter:p width:width andHeight:height];
-                    [clusters addObject:c];
+            if(activeTrace) {
+                for(Robot* robot in robots) {
+                    activeTrace->setRobot([robot index], [robot position].x, [robot position].y, [robot status]);
                 }
-                
+                activeTrace->endTick(tick);
+            }
+            
+            //Frames are at least frameInterval ticks apart, and wait for the consumer to take the previous one.
+            if(publishesFrames && (tick >= nextFrameTick) && frameBuffer->wantsFrame()) {
+                [self publishFrameForTeam:team atTick:tick onGrid:grid withRobots:robots tagBoard:tagBoard tagPositions:tagPositions
+                               pheromones:pheromones pheromoneField:context.pheromoneField clusters:clusters];
+                nextFrameTick = tick + MAX(frameInterval, 1);
+            }
+            
+            if(context.pheromoneField) {
+                [self updatePheromoneField:pheromoneField forTeam:team atTick:tick];
+            }
+            
+            if ((clusteringTagCutoff >= 0) && ((int)totalCollectedTags.size() >= [self clusteringTagCutoff]) && !clustered) {
+                [self setClusters:clusters fromCollectedTags:totalCollectedTags];
                 [team setPredictedClusters:(int)[clusters count]];
                 clustered = YES;
             }
@@ -242,276 +915,634 @@ using namespace cv;
                 break;
             }
             
-            if(tickRate != 0.f){[NSThread sleepForTimeInterval:tickRate];}
+            if((tickRate != 0.f) && !viewTakesFrames){[NSThread sleepForTimeInterval:tickRate];}
             
-            if(viewDelegate != nil) {
-                if([viewDelegate respondsToSelector:@selector(updateDisplayWindowWithRobots:team:grid:pheromones:clusters:)]) {
-                    [Pheromone getPheromone:pheromones atTick:tick];
-                    [viewDelegate updateDisplayWindowWithRobots:[robots copy] team:team grid:grid pheromones:[pheromones copy] clusters:[clusters copy]];
+            if((viewDelegate != nil) && !viewTakesFrames) {
+                @autoreleasepool {
+                    BOOL viewTakesTiledGrid = [viewDelegate respondsToSelector:@selector(updateDisplayWindowWithRobots:team:tiledGrid:pheromones:clusters:)];
+                    if(viewTakesTiledGrid || [viewDelegate respondsToSelector:@selector(updateDisplayWindowWithRobots:team:grid:pheromones:clusters:)]) {
+                        NSMutableArray* pheromoneObjects;
+                        if(context.pheromoneField) {
+                            pheromoneObjects = pheromoneArray(pheromoneField, [team pheromoneDecayRate], tick);
+                        }
+                        else {
+                            samplePheromone(pheromones, tick);
+                            pheromoneObjects = pheromoneArray(pheromones);
+                        }
+                        if(viewTakesTiledGrid) {
+                            [viewDelegate updateDisplayWindowWithRobots:[robots copy] team:team tiledGrid:grid pheromones:pheromoneObjects clusters:[clusters copy]];
+                        }
+                        else {
+                            [viewDelegate updateDisplayWindowWithRobots:[robots copy] team:team grid:[self viewGridFor:grid] pheromones:pheromoneObjects clusters:[clusters copy]];
+                        }
+                    }
                 }
             }
             
-            if(delegate && [delegate respondsToSelector:@selector(simulation:didFinishTick:)]) {
-                [delegate simulation:self didFinishTick:tick];
+            if(events && events->wantsTicks()) {
+                [self pushTickEvent:tick remainingTags:countRemainingTags(tagBoard)];
             }
         }
+        
+        if(publishesFrames) {
+            framePublisherClaimed = false;
+        }
+        if(performanceCounters) {
+            performanceCounters->addTicks(ticksRun, robotCount);
+        }
     }
 }
 
 /*
- * State transition case statement for robots using central-place foraging algorithm
+ * Lockstep alternative to the team-by-team loop of evaluateTeams:.
+ * All teams are simulated at once on the distribution already laid out in grid, each with its own robots,
+ * tag board and pheromones, advancing one tick at a time in turn. The world is reset only once and stays in cache,
+ * instead of being swept again before every team.
+ *
+ * Cells and tags are shared, so each team keeps its explored flags in its own bits and its pickups in its own
+ * tag board only. Robots draw from per-team streams seeded from the shared one in team order, so a batch is
+ * reproducible for a given seed no matter how its teams interleave, though it differs from sequential mode.
+ *
+ * Teams are interleaved rather than vectorized across each other: robots are Objective-C objects that the kernel
+ * messages for every state change, so laying their state out team-major would mean a second, C++ only kernel.
  */
--(NSMutableArray*) stateTransition:(NSMutableArray*)robots inTeam:(Team*)team atTick:(int)tick onGrid:(vector<vector<Cell*>>&)grid
-                    withPheromones:(NSMutableArray*)pheromones andClusters:(NSMutableArray*)clusters {
+-(void) evaluateTeamsInLockstep:(NSMutableArray*)teams onGrid:(TiledGrid&)grid forTicks:(int)ticks {
+    [self resetGrid:grid];
     
-    NSMutableArray* collectedTags = [[NSMutableArray alloc] init];
+    TagBoard initialTagBoard;
+    tagBoardFromGrid(initialTagBoard, grid);
     
-    for (Robot* robot in robots) {
-        switch([robot status]) {
-                
-            /*
-             * The robot hasn't been initialized yet.
-             * Give it some basic starting values and then fall-through to the next state.
-             */
-            case ROBOT_STATUS_INACTIVE: {
-                [robot setStatus:ROBOT_STATUS_DEPARTING];
-                [robot setPosition:nest];
-                [robot setTarget:edge(gridSize)];
-                //Fallthrough to ROBOT_STATUS_DEPARTING.
-            }
-                
-            /*
-             * The robot is either:
-             *  -Moving in a random direction away from the nest (not site-fidelity-ing or pheromone-ing).
-             *  -Moving towards a specific point where a tag was last found (site-fidelity-ing).
-             *  -Moving towards a specific point due to pheromones.
-             *
-             * For each of the cases, we have to ultimately decide on a direction for the robot to travel in,
-             * then decide which 'cell' best accomplishes traveling in this direction.  We then move the robot,
-             * and may change the robot/world state based on certain criteria (i.e. it reaches its destination).
-             */
-            case ROBOT_STATUS_DEPARTING: {
-                
-                //Delay to emulate physical robot
-                if([robot delay]) {
-                    [robot setDelay:[robot delay] - 1];
-                    break;
-                }
-                
-                if((![robot informed] && (!useTravel || (randomFloat(1.) < team.travelGiveUpProbability))) || (NSEqualPoints([robot position], [robot target]))) {
-                    [robot setStatus:ROBOT_STATUS_SEARCHING];
-                    [robot setInformed:(useInformedWalk & [robot informed])];
-                    [robot turnWithParameters:team];
-                    break;
-                }
-                
-                [robot moveWithin:gridSize];
-                break;
+    int teamCountInBatch = (int)[teams count];
+    vector<LockstepTeam> states(teamCountInBatch);
+    for(int t = 0; t < teamCountInBatch; t++) {
+        LockstepTeam& state = states[t];
+        state.team = [teams objectAtIndex:t];
+        state.robots = [[NSMutableArray alloc] initWithCapacity:robotCount];
+        state.clusters = [[NSMutableArray alloc] init];
+        state.tagBoard = initialTagBoard;
+        state.pheromones.reserve(tagCount);
+        state.collectedTags.reserve(tagCount);
+        state.clustered = NO;
+        state.finished = NO;
+        
+        state.neighborGrid = useNeighborAvoidance ? [[NeighborGrid alloc] initWithSize:gridSize bucketSize:neighborRadius andCapacity:robotCount] : nil;
+        for(int i = 0; i < robotCount; i++) {
+            Robot* robot = [[Robot alloc] init];
+            [robot setIndex:i];
+            [robot setNeighborGrid:state.neighborGrid];
+            [state.robots addObject:robot];
+        }
+        
+        //states is never resized from here on, so pointers into it stay valid.
+        state.context = [self transitionContextForTeam:state.team];
+        state.context.neighborGrid = state.neighborGrid;
+        state.context.tagBoard = &state.tagBoard;
+        if((pheromoneModel == PheromoneFieldModelId) && usePheromone) {
+            state.pheromoneField.reset(gridSize.width, gridSize.height);
+            state.context.pheromoneField = &state.pheromoneField;
+        }
+        
+        state.exploredBits.assign(((int64_t)gridSize.width * (int64_t)gridSize.height + 63) / 64, 0);
+        state.context.exploredBits = state.exploredBits.data();
+        
+        uint64_t seed = ((uint64_t)random() << 31) ^ random();
+        state.randomStates.resize(robotCount);
+        for(int i = 0; i < robotCount; i++) {
+            state.randomStates[i] = randomStateFromSeed(seed + i);
+        }
+        state.context.randomStates = state.randomStates.data();
+    }
+    
+    PerformanceScope tickScope(performanceCounters, PerformancePhaseTicks);
+    int remainingTeams = teamCountInBatch;
+    for(int tick = 0; (ticks >= 0 ? tick < ticks : YES) && remainingTeams; tick++) {
+        if(performanceCounters) {
+            performanceCounters->addTicks(remainingTeams, robotCount);
+        }
+        
+        for(LockstepTeam& state : states) {
+            if(state.finished) {
+                continue;
             }
+            
+            @autoreleasepool {
+                int collectedTags = transitionKernel(state.robots, state.context, tick, grid, state.pheromones, state.clusters, state.collectedTags);
+                [state.team setFitness:[state.team fitness] + collectedTags];
                 
-            /*
-             * The robot is performing a random walk.
-             * It will randomly change its direction based on how long it has been searching and move in this direction.
-             * If it finds a tag, its state changes to ROBOT_STATUS_RETURNING (it brings the tag back to the nest.
-             * All site fidelity and pheromone work, however, is taken care of once the robot actually arrives at the nest.
-             */
-            case ROBOT_STATUS_SEARCHING: {
-                
-                //Delay to emulate physical robot
-                if([robot delay]) {
-                    [robot setDelay:[robot delay] - 1];
-                    break;
+                if(state.context.pheromoneField) {
+                    [self updatePheromoneField:state.pheromoneField forTeam:state.team atTick:tick];
                 }
-
-                //Probabilistically give up searching and return to the nest
-                if(useGiveUp && (randomFloat(1.) < [team searchGiveUpProbability])) {
-                    [robot setTarget:nest];
-                    [robot setStatus:ROBOT_STATUS_RETURNING];
-                    break;
-                }
-                
-                //Calculate end point
-                [robot setTarget:NSMakePoint(roundf([robot position].x + (cos(robot.direction))), roundf([robot position].y + (sin([robot direction]))))];
                 
-                //If our current direction takes us outside the world, frantically spin around until this isn't the case.
-                while([robot target].x < 0 || [robot target].y < 0 || [robot target].x >= gridSize.width || [robot target].y >= gridSize.height) {
-                    [robot setDirection:randomFloat(M_2PI)];
-                    [robot setTarget:NSMakePoint(roundf([robot position].x + cos([robot direction])), roundf([robot position].y + sin([robot direction])))];
+                if ((clusteringTagCutoff >= 0) && ((int)state.collectedTags.size() >= clusteringTagCutoff) && !state.clustered) {
+                    [self setClusters:state.clusters fromCollectedTags:state.collectedTags];
+                    [state.team setPredictedClusters:(int)[state.clusters count]];
+                    state.clustered = YES;
                 }
                 
-                //Move one cell
-                [robot moveWithin:gridSize];
-                Cell* currentCell = grid[[robot position].y][[robot position].x];
-                if (![currentCell isExplored]) {
-                    [currentCell setIsExplored:YES];
-                    if ([currentCell region]) {
-                        [[currentCell region] setDirty:YES];
-                    }
+                if ((evaluationCount == 1) && ([state.team fitness] == tagCount)) {
+                    [state.team setTimeToCompleteCollection:tick];
+                    state.finished = YES;
+                    remainingTeams--;
+                    continue;
                 }
                 
-                //Turn
-                [robot turnWithParameters:team];
-                
-                //After we've moved 1 square ahead, check one square ahead for a tag.
-                //Reusing robot.target here (without consequence, it just gets overwritten when moving).
-                [robot setTarget:NSMakePoint(roundf([robot position].x + cos([robot direction])), roundf([robot position].y + sin([robot direction])))];
-                if([robot target].x >= 0 && [robot target].y >= 0 && [robot target].x < gridSize.width && [robot target].y < gridSize.height) {
-                    Tag* foundTag = [grid[[robot target].y][[robot target].x] tag];
-                    //Note we use shortcircuiting here.
-                    if([error detectTag] && foundTag && ![foundTag pickedUp]) {
-                        //Perturb found tag position to simulate error
-                        NSPoint perturbedTagPosition = [error perturbTagPosition:[foundTag position] withGridSize:gridSize andGridCenter:nest];
-                        Tag* tagCopy = [foundTag copy];
-                        [tagCopy setPosition:perturbedTagPosition];
-                        
-                        [robot setDiscoveredTags:[[NSMutableArray alloc] initWithObjects:tagCopy, nil]];
-                        [foundTag setPickedUp:YES];
-                        
-                        //Sum up all non-picked-up seeds in the moore neighbor.
-                        for(int dx = -1; dx <= 1; dx++) {
-                            for(int dy = -1; dy <= 1; dy++) {
-                                
-                                //If neighboring cell is legal
-                                if(([foundTag position].x + dx >= 0 && [foundTag position].x + dx < gridSize.width) &&
-                                   ([foundTag position].y + dy >= 0 && [foundTag position].y + dy < gridSize.height))
-                                {
-                                    //Look up tag in tags array
-                                    Cell* cell = grid[[foundTag position].y + dy][[foundTag position].x + dx];
-                                    
-                                    //If tag exists and is detectable
-                                    if (([cell tag]) && !([[cell tag] pickedUp]) && [error detectTag]) {
-                                        //Add it to discoveredTags array
-                                        [[robot discoveredTags] addObject:[cell tag]];
-                                    }
-                                }
-                            }
-                        }
-                        
-                        [robot setStatus:ROBOT_STATUS_RETURNING];
-                        [robot setDelay:9];
-                        [robot setTarget:nest];
-                        
-                        if(delegate && [delegate respondsToSelector:@selector(simulation:didPickupTag:atTick:)]) {
-                            [delegate simulation:self didPickupTag:foundTag atTick:tick];
-                        }
-                    }
+                //One tick event per team and tick, as in the team-by-team loop.
+                if(events && events->wantsTicks()) {
+                    [self pushTickEvent:tick remainingTags:countRemainingTags(state.tagBoard)];
                 }
-                
-                break;
             }
-                
-            /*
-             * The robot is on its way back to the nest.
-             * It is either carrying food, or it gave up on its search and is returning to base for further instruction.
-             * Stuff like laying/assigning of pheromones is handled here.
-             */
-            case ROBOT_STATUS_RETURNING: {
-                
-                //Delay to emulate physical robot
-                if([robot delay]) {
-                    [robot setDelay:[robot delay] - 1];
-                    break;
-                }
-                
-                [robot moveWithin:gridSize];
-                
-                if(NSEqualPoints(robot.position, nest)) {
-                    //Retrieve collected tag from discoveredTags array (if available)
-                    Tag* foundTag = nil;
-                    if ([[robot discoveredTags] count] > 0) {
-                        foundTag = [[robot discoveredTags] objectAtIndex:0];
-                        [collectedTags addObject:foundTag];
-                    }
-                    
-                    //Add (perturbed) tag position to global pheromone array
-                    if (foundTag && (randomFloat(1.) < poissonCDF([[robot discoveredTags] count], [team pheromoneLayingRate]))) {
-                        Pheromone* pheromone = [[Pheromone alloc] initWithPosition:[foundTag position] weight:1. decayRate:[team pheromoneDecayRate] andUpdatedTick:tick];
-                        [pheromones addObject:pheromone];
-                        
-                        if(delegate && [delegate respondsToSelector:@selector(simulation:didPlacePheromone:atTick:)]) {
-                            [delegate simulation:self didPlacePheromone:pheromone atTick:tick];
-                        }
-                    }
-                    
-                    //Set required local variables
-                    BOOL decisionFlag = randomFloat(1.) < poissonCDF([[robot discoveredTags] count], [team siteFidelityRate]);
-                    NSPoint pheromonePosition = [Pheromone getPheromone:pheromones atTick:tick];
-                    
-                    if([clusters count]) {
-                        int r = randomInt((int)[clusters count]);
-                        Cluster* target = [clusters objectAtIndex:r];
-                        int x = clip(randomIntRange([target center].x - [target width]/2, [target center].x + [target width]/2), 0, gridSize.width - 1);
-                        int y = clip(randomIntRange([target center].y - [target height]/2, [target center].y + [target height]/2), 0, gridSize.height - 1);
-                        [robot setTarget:NSMakePoint(x, y)];
-                        [robot setInformed:ROBOT_INFORMED_PHEROMONE];
-                    }
-                    
-                    //If a tag was found, decide whether to return to its location
-                    else if(foundTag && useSiteFidelity && decisionFlag) {
-                        [robot setTarget:[error perturbTargetPosition:[foundTag position] withGridSize:gridSize andGridCenter:nest]];
-                        [robot setInformed:ROBOT_INFORMED_MEMORY];
-                    }
-                    
-                    //If no pheromones exist, pheromone will be (-1, -1)
-                    else if(!NSEqualPoints(pheromonePosition, NSNullPoint) && usePheromone && !decisionFlag) {
-                        [robot setTarget:[error perturbTargetPosition:pheromonePosition withGridSize:gridSize andGridCenter:nest]];
-                        [robot setInformed:ROBOT_INFORMED_PHEROMONE];
-                    }
-                    
-                    //If no pheromones and no tag and no partitioning knowledge, go to a random location
-                    else {
-                        [robot setTarget:edge(gridSize)];
-                        [robot setInformed:ROBOT_INFORMED_NONE];
-                    }
-                    
-                    [robot setDiscoveredTags:nil];
-                    [robot setSearchTime:0];
-                    [robot setStatus:ROBOT_STATUS_DEPARTING];
+        }
+        
+        if(tickRate != 0.f){[NSThread sleepForTimeInterval:tickRate];}
+    }
+}
+
+/*
+ * Runs one tick of the transition kernel with the world cut into horizontal strips of stripHeight rows.
+ *
+ * Robots are bucketed by row before every tick (which is how they migrate between strips), keeping swarm order
+ * within each strip. Even strips then run concurrently, followed by odd strips. In one tick a robot reaches at most
+ * three rows beyond its own (move, look ahead, Moore neighborhood of the tag ahead), and strips are at least two
+ * tiles high, so strips running together never share tag board words, tiles, cells or tags. Tags can only be
+ * delivered and pheromones only laid or sampled by robots within a row of the nest, which all lie in one strip or
+ * two adjacent ones, so those never run concurrently either.
+ *
+ * Robots draw from their own random streams (context.randomStates), so the result does not depend on the number of
+ * threads, but it does differ from the sequential kernel's.
+ */
+-(int) transitionInStrips:(NSMutableArray*)strips ofHeight:(int)stripHeight withRobots:(NSMutableArray*)robots context:(TransitionContext&)context
+                   atTick:(int)tick onGrid:(TiledGrid&)grid withPheromones:(vector<PheromoneRecord>&)pheromones
+                 clusters:(NSMutableArray*)clusters andCollectedTags:(vector<NSPoint>&)collectedTags {
+    int stripCount = (int)[strips count];
+    for(NSMutableArray* strip in strips) {
+        [strip removeAllObjects];
+    }
+    for(Robot* robot in robots) {
+        int y = ([robot position].y < 0) ? nest.y : [robot position].y; //Inactive robots start at the nest.
+        [[strips objectAtIndex:MIN(y / stripHeight, stripCount - 1)] addObject:robot];
+    }
+    
+    //Blocks would copy C++ objects captured by reference, so hand them pointers.
+    vector<int> collected(stripCount, 0);
+    int* collectedPointer = collected.data();
+    TransitionContext* contextPointer = &context;
+    TiledGrid* gridPointer = &grid;
+    vector<PheromoneRecord>* pheromonesPointer = &pheromones;
+    vector<NSPoint>* collectedTagsPointer = &collectedTags;
+    TransitionKernel kernel = transitionKernel;
+    
+    dispatch_queue_t queue = dispatch_get_global_queue(0, 0);
+    for(int phase = 0; phase < 2; phase++) {
+        dispatch_apply((stripCount + 1 - phase) / 2, queue, ^(size_t i) {
+            @autoreleasepool {
+                int strip = (int)(2 * i) + phase;
+                collectedPointer[strip] = kernel([strips objectAtIndex:strip], *contextPointer, tick, *gridPointer,
+                                                 *pheromonesPointer, clusters, *collectedTagsPointer);
+            }
+        });
+    }
+    
+    int total = 0;
+    for(int count : collected) {
+        total += count;
+    }
+    return total;
+}
+
+/*
+ * Applies decay and diffusion to a pheromone field once every pheromoneUpdateInterval ticks.
+ * Decay over the whole interval is applied at once, matching what the records would have decayed by.
+ */
+-(void) updatePheromoneField:(PheromoneField&)field forTeam:(Team*)team atTick:(int)tick {
+    int interval = MAX(pheromoneUpdateInterval, 1);
+    if((tick + 1) % interval == 0) {
+        field.update(exponentialDecay(1., interval, [team pheromoneDecayRate]), pheromoneDiffusionRate, .001);
+    }
+}
+
+/*
+ * Clears per-evaluation cell and tag state, leaving the tag distribution in place.
+ */
+-(void) resetGrid:(TiledGrid&)grid {
+    grid.forEachCell([](Cell* cell, int x, int y) {
+        [cell setIsClustered:NO];
+        [cell setIsExplored:NO];
+        if([cell tag]) {
+            [[cell tag] setDiscovered:NO];
+            [[cell tag] setPickedUp:NO];
+        }
+    });
+}
+
+/*
+ * Dense grid of the cells of grid, for views that predate TiledGrid.
+ * Allocates every tile, as the dense grid did; it is rebuilt only when the grid or its tiles change.
+ */
+-(vector<vector<Cell*>>&) viewGridFor:(TiledGrid&)grid {
+    if(!viewGridSource.sharesCellsWith(grid) || (viewGridReleaseCount != grid.releaseCount())) {
+        viewGrid.assign(grid.height(), vector<Cell*>(grid.width()));
+        for(int y = 0; y < grid.height(); y++) {
+            for(int x = 0; x < grid.width(); x++) {
+                viewGrid[y][x] = grid[y][x];
+            }
+        }
+        viewGridSource = grid;
+        viewGridReleaseCount = grid.releaseCount();
+    }
+    return viewGrid;
+}
+
+/*
+ * Replaces clusters with the ones found by EM in the positions of the collected tags.
+ */
+-(void) setClusters:(NSMutableArray*)clusters fromCollectedTags:(vector<NSPoint>&)collectedTags {
+    PerformanceScope clusteringScope(performanceCounters, PerformancePhaseClustering);
+    EM em = [Cluster trainOptimalEMWithPoints:collectedTags];
+    Mat means = em.get<Mat>("means");
+    vector<Mat> covs = em.get<vector<Mat>>("covs");
+    
+    [clusters removeAllObjects];
+    for(int i = 0; i < means.size().height; i++) {
+        NSPoint p = NSMakePoint(round(means.at<double>(i,0)), round(means.at<double>(i,1)));
+        double width = ceil(covs[i].at<double>(0,0));
+        double height = ceil(covs[i].at<double>(1,1));
+        Cluster* c = [[Cluster alloc] initWithCenter:p width:width andHeight:height];
+        [clusters addObject:c];
+    }
+}
+
+/*
+ * State transition for robots following the current behavior (central-place foraging algorithm by default).
+ * The work is done by the kernel specialized for the behavior and its feature flags (see StateTransition.h).
+ */
+-(int) stateTransition:(NSMutableArray*)robots inTeam:(Team*)team atTick:(int)tick onGrid:(TiledGrid&)grid
+        withPheromones:(vector<PheromoneRecord>&)pheromones clusters:(NSMutableArray*)clusters andCollectedTags:(vector<NSPoint>&)collectedTags {
+    [self selectTransitionKernel];
+    
+    //Callers outside evaluateTeams: only have the grid, so derive the tag board from it once per grid.
+    //The kernel clears a tag's bit when it picks the tag up, so the board stays in step across calls.
+    if(!wrapperTagBoardGrid.sharesCellsWith(grid) || (wrapperTagBoardLayout != grid.layoutCount())) {
+        tagBoardFromGrid(wrapperTagBoard, grid);
+        wrapperTagBoardGrid = grid;
+        wrapperTagBoardLayout = grid.layoutCount();
+    }
+    
+    TransitionContext context = [self transitionContextForTeam:team];
+    context.tagBoard = &wrapperTagBoard;
+    return transitionKernel(robots, context, tick, grid, pheromones, clusters, collectedTags);
+}
+
+/*
+ * Picks the state transition kernel instantiated for the current behavior and feature flags,
+ * unless the one already picked was for the same ones (they may change between calls outside run).
+ * The error model is only applied when observedError is set; otherwise it is the identity.
+ */
+-(void) selectTransitionKernel {
+    int key = (behavior << 6) | (!!useTravel << 5) | (!!useGiveUp << 4) | (!!useSiteFidelity << 3) |
+              (!!usePheromone << 2) | (!!useInformedWalk << 1) | !!observedError;
+    if(transitionKernel && key == transitionKernelKey) {
+        return;
+    }
+    transitionKernel = selectTransitionKernel(behavior, useTravel, useGiveUp, useSiteFidelity, usePheromone, useInformedWalk, observedError);
+    transitionKernelKey = key;
+}
+
+/*
+ * (Re)builds the nest field if the world has changed since it was last built.
+ * Must be called before evaluations are dispatched, as workers share the field.
+ */
+-(void) prepareNestField {
+    if(gridSize.width * gridSize.height > NEST_FIELD_MAX_CELLS) {
+        nestField = nil;
+    }
+    else if(!nestField || ![nestField matchesSize:gridSize andNest:nest]) {
+        nestField = [[NestField alloc] initWithSize:gridSize andNest:nest];
+    }
+}
+
+/*
+ * Gathers the per-team constants used by the state transition kernel.
+ */
+-(TransitionContext) transitionContextForTeam:(Team*)team {
+    TransitionContext context;
+    context.events = events;
+    context.notifyPickup = events && events->wantsPickups();
+    context.notifyPheromone = events && events->wantsPheromones();
+    
+    context.error = error;
+    context.gridSize = gridSize;
+    context.nest = nest;
+    context.nestField = nestField;
+    context.tagBoard = NULL;
+    context.pheromoneField = NULL;
+    
+    context.neighborGrid = nil;
+    context.neighborRadius = neighborRadius;
+    
+    context.robotCount = robotCount;
+    context.randomStates = NULL;
+    context.trace = NULL;
+    context.exploredCells = NULL;
+    context.exploredCellsLock = NULL;
+    context.exploredBits = NULL;
+    
+    context.team = team;
+    context.travelGiveUpProbability = [team travelGiveUpProbability];
+    context.searchGiveUpProbability = [team searchGiveUpProbability];
+    context.pheromoneDecayRate = [team pheromoneDecayRate];
+    context.pheromoneLayingRate = [team pheromoneLayingRate];
+    context.siteFidelityRate = [team siteFidelityRate];
+    
+    return context;
+}
+
+/*
+ * Starts delivering events to the delegate if it observes any and no pipeline is running.
+ * Returns YES if a pipeline was started, in which case the caller must stop it.
+ */
+-(BOOL) startEvents {
+    if(events) {
+        return NO;
+    }
+    events = new EventPipeline(self, delegate);
+    if(!events->wantsAny()) {
+        delete events;
+        events = NULL;
+        return NO;
+    }
+    return YES;
+}
+
+/*
+ * Delivers all pending events and shuts the pipeline down.
+ */
+-(void) stopEvents {
+    if(events && events->droppedEventCount()) {
+        printf("Dropped %llu events\n", events->droppedEventCount());
+    }
+    delete events;
+    events = NULL;
+}
+
+-(void) pushTickEvent:(int)tick remainingTags:(int)remainingTags {
+    if(events && events->wantsTicks()) {
+        SimulationEvent event = {SimulationEventTick, tick, NSZeroPoint, 0, 0., 0., NULL, remainingTags};
+        events->push(event);
+    }
+}
+
+/*
+ * Starts handing frames to the view if it takes them, and to frame stream clients if frameStreamAddress is set,
+ * unless frames are already running. Both are paced by a timer on their own queue, so the simulation never waits for them.
+ * Returns YES if frames were started, in which case the caller must stop them.
+ */
+-(BOOL) startFrames {
+    if(frameBuffer) {
+        return NO;
+    }
+    viewTakesFrames = viewDelegate && [viewDelegate respondsToSelector:@selector(updateDisplayWindowWithFrame:)];
+    
+    FrameServer* server = NULL;
+    if(frameStreamAddress) {
+        server = new FrameServer();
+        if(!server->open([frameStreamAddress UTF8String])) {
+            printf("Could not stream frames to %s\n", [frameStreamAddress UTF8String]);
+            delete server;
+            server = NULL;
+        }
+    }
+    if(!viewTakesFrames && !server) {
+        return NO;
+    }
+    frameBuffer = new FrameBuffer();
+    frameServer = server;
+    
+    FrameBuffer* buffer = frameBuffer;
+    NSObject* view = viewTakesFrames ? viewDelegate : nil;
+    dispatch_queue_t queue = dispatch_queue_create("iAnt-Sim.frames", DISPATCH_QUEUE_SERIAL);
+    frameTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+    uint64_t interval = (uint64_t)(NSEC_PER_SEC / MAX(frameRate, 1.f));
+    dispatch_source_set_timer(frameTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    dispatch_source_set_event_handler(frameTimer, ^{
+        const SimulationFrame* frame = buffer->acquire();
+        if(frame) {
+            @autoreleasepool {
+                [view updateDisplayWindowWithFrame:*frame];
+            }
+            if(server) {
+                server->send(*frame);
+            }
+        }
+        else if(server) {
+            server->flush();
+        }
+    });
+    dispatch_resume(frameTimer);
+    
+    if(server) {
+        frameListener = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, server->socket(), 0, queue);
+        dispatch_source_set_event_handler(frameListener, ^{
+            server->acceptClients();
+        });
+        dispatch_resume(frameListener);
+    }
+    return YES;
+}
+
+/*
+ * Delivers the last frame, then stops the timer and frees the buffer and server.
+ */
+-(void) stopFrames {
+    if(!frameBuffer) {
+        return;
+    }
+    FrameBuffer* buffer = frameBuffer;
+    FrameServer* server = frameServer;
+    NSObject* view = viewTakesFrames ? viewDelegate : nil;
+    if(server) {
+        //Both sources share the timer's serial queue, so the server is deleted after the listener's last use.
+        dispatch_source_cancel(frameListener);
+        frameListener = nil;
+    }
+    dispatch_source_set_cancel_handler(frameTimer, ^{
+        const SimulationFrame* frame = buffer->acquire();
+        if(frame) {
+            @autoreleasepool {
+                [view updateDisplayWindowWithFrame:*frame];
+            }
+            if(server) {
+                server->send(*frame);
+            }
+        }
+        if(server) {
+            server->flush();
+            printf("Streamed %llu frames, dropped %llu\n", server->sentFrames, server->droppedFrames);
+            delete server;
+        }
+        delete buffer;
+    });
+    dispatch_source_cancel(frameTimer);
+    frameTimer = nil;
+    frameBuffer = NULL;
+    frameServer = NULL;
+    viewTakesFrames = NO;
+}
+
+/*
+ * Copies the state the view draws into the back frame and publishes it.
+ * Pheromone weights are decayed to tick without touching the records, so publishing never changes the simulation.
+ * Explored bits are only added for cells explored since the frame was last filled, and tags are looked up where they
+ * were placed, so neither costs a pass over the whole world.
+ */
+-(void) publishFrameForTeam:(Team*)team atTick:(int)tick onGrid:(TiledGrid&)grid withRobots:(NSMutableArray*)robots tagBoard:(const TagBoard&)tagBoard tagPositions:(const vector<NSPoint>&)tagPositions
+                 pheromones:(const vector<PheromoneRecord>&)pheromones pheromoneField:(const PheromoneField*)pheromoneField clusters:(NSMutableArray*)clusters {
+    SimulationFrame& frame = frameBuffer->backFrame();
+    frame.tick = tick;
+    frame.fitness = [team fitness];
+    frame.width = grid.width();
+    frame.height = grid.height();
+    
+    frame.robots.clear();
+    for(Robot* robot in robots) {
+        FrameRobot state = {(int32_t)[robot position].x, (int32_t)[robot position].y, (uint8_t)[robot status], (uint8_t)[robot informed]};
+        frame.robots.push_back(state);
+    }
+    
+    if(frame.exploredEvaluation != frameEvaluation) {
+        frame.explored.assign((((int64_t)frame.width * frame.height) + 63) / 64, 0);
+        frame.exploredEvaluation = frameEvaluation;
+        frame.exploredCount = 0;
+    }
+    {
+        lock_guard<mutex> lock(frameExploredCellsLock);
+        for(; frame.exploredCount < frameExploredCells.size(); frame.exploredCount++) {
+            int64_t bit = frameExploredCells[frame.exploredCount];
+            frame.explored[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+    
+    frame.tags.clear();
+    for(NSPoint position : tagPositions) {
+        if(hasTagAt(tagBoard, position.x, position.y)) {
+            frame.tags.push_back(position);
+        }
+    }
+    
+    frame.pheromones.clear();
+    if(pheromoneField) {
+        for(int y = 0; (pheromoneField->total() > 0.f) && (y < pheromoneField->height()); y++) {
+            for(int x = 0; x < pheromoneField->width(); x++) {
+                if(pheromoneField->massAt(x, y) > 0.f) {
+                    FramePheromone pheromone = {(int32_t)x, (int32_t)y, pheromoneField->massAt(x, y)};
+                    frame.pheromones.push_back(pheromone);
                 }
-                break;
+            }
+        }
+    }
+    else {
+        for(const PheromoneRecord& record : pheromones) {
+            float weight = exponentialDecay(record.weight, tick - record.updatedTick, record.decayRate);
+            if(weight >= .001) {
+                FramePheromone pheromone = {(int32_t)record.position.x, (int32_t)record.position.y, weight};
+                frame.pheromones.push_back(pheromone);
             }
         }
     }
     
-    return collectedTags;
+    frame.clusters.clear();
+    for(Cluster* cluster in clusters) {
+        FrameCluster box = {(float)[cluster center].x, (float)[cluster center].y, (float)[cluster width], (float)[cluster height]};
+        frame.clusters.push_back(box);
+    }
+    
+    frameBuffer->publish();
 }
 
 /*
- * Run post evaluations of the average team from the final generation (i.e. generationCount)
+ * Run post evaluations of team (the average team from the final generation (i.e. generationCount) when called by run)
+ * The results hold fitnessSummary, timeSummary and clustersSummary (see dictionaryFromStatistics),
+ * plus the fitness, time and clusters of every evaluation if keepPostEvaluationSamples is set.
  */
--(NSMutableDictionary*) evaluateTeam:(Team*)team onGrid:(vector<vector<Cell*>>)grid{
+-(NSMutableDictionary*) evaluateTeam:(Team*)team onGrid:(TiledGrid)grid{
     NSMutableArray* fitness = [[NSMutableArray alloc] init];
     NSMutableArray* time = [[NSMutableArray alloc] init];
     NSMutableArray* clusters = [[NSMutableArray alloc] init];
-    NSMutableArray* teams = [[NSMutableArray alloc] initWithObjects:averageTeam, nil];
+    StreamingStatistics fitnessStatistics(0, tagCount);
+    StreamingStatistics timeStatistics(0, MAX(tickCount, 1));
+    StreamingStatistics clustersStatistics(0, STREAMING_HISTOGRAM_BIN_COUNT);
+    NSMutableArray* teams = [[NSMutableArray alloc] initWithObjects:team, nil];
+    
+    [self prepareNestField];
+    
+    BOOL ownsEvents = [self startEvents];
+    BOOL ownsFrames = [self startFrames];
+    
+    TraceWriter trace;
+    if(traceDirectory) {
+        [[NSFileManager defaultManager] createDirectoryAtPath:traceDirectory withIntermediateDirectories:YES attributes:nil error:nil];
+    }
     
     for (int i = 0; i < postEvaluations; i++) {
         
         //Reset
-        [averageTeam setFitness:0.];
-        [averageTeam setTimeToCompleteCollection:0.];
+        [team setFitness:0.];
+        [team setTimeToCompleteCollection:0.];
+        
+        if(traceDirectory) {
+            NSString* path = [traceDirectory stringByAppendingPathComponent:[NSString stringWithFormat:@"evaluation-%d.trace", i]];
+            activeTrace = trace.open([path fileSystemRepresentation], robotCount, gridSize.width, gridSize.height) ? &trace : NULL;
+        }
         
         //Evaluate
-        [self evaluateTeams:teams onGrid:grid];
-        [fitness addObject:@([averageTeam fitness])];
-        [time addObject:@([averageTeam timeToCompleteCollection])];
-        [clusters addObject:@([averageTeam predictedClusters])];
+        @autoreleasepool {
+            [self evaluateTeams:teams onGrid:grid];
+        }
+        
+        if(activeTrace) {
+            if(!trace.close()) {
+                printf("Could not write trace of evaluation %d\n", i);
+            }
+            activeTrace = NULL;
+        }
+        fitnessStatistics.add([team fitness]);
+        timeStatistics.add([team timeToCompleteCollection]);
+        clustersStatistics.add([team predictedClusters]);
+        if(keepPostEvaluationSamples) {
+            [fitness addObject:@([team fitness])];
+            [time addObject:@([team timeToCompleteCollection])];
+            [clusters addObject:@([team predictedClusters])];
+        }
+    }
+    
+    if(ownsEvents) {
+        [self stopEvents];
+    }
+    if(ownsFrames) {
+        [self stopFrames];
     }
     
-    return [@{@"fitness":fitness, @"time":time, @"clusters":clusters} mutableCopy];
+    NSMutableDictionary* results = [@{@"fitnessSummary":dictionaryFromStatistics(fitnessStatistics),
+                                      @"timeSummary":dictionaryFromStatistics(timeStatistics),
+                                      @"clustersSummary":dictionaryFromStatistics(clustersStatistics)} mutableCopy];
+    if(keepPostEvaluationSamples) {
+        [results setObject:fitness forKey:@"fitness"];
+        [results setObject:time forKey:@"time"];
+        [results setObject:clusters forKey:@"clusters"];
+    }
+    return results;
 }
 
 /*
  * Creates a random distribution of tags.
- * Called at the beginning of each evaluation.
+ * Called at the beginning of each evaluation; also frees the tiles that no longer hold anything.
  */
--(void) initDistributionForArray:(vector<vector<Cell*>>&)grid {
+-(void) initDistributionForArray:(TiledGrid&)grid {
+    PerformanceScope distributionScope(performanceCounters, PerformancePhaseDistribution);
     
-    for(vector<Cell*> v : grid) {
-        for (Cell* cell : v) {
-            [cell setTag:nil];
-        }
-    }
+    grid.forEachCell([](Cell* cell, int x, int y) {
+        [cell setTag:nil];
+    });
+    grid.tagsLaidOut(); //Only touches this grid, so concurrent evaluations on their own grids don't race.
     
     int pilesOf[tagCount + 1]; //Key is size of pile.  Value is number of piles with this many tags.
     for(int i = 0; i <= tagCount; i++){pilesOf[i]=0;}
@@ -583,50 +1614,67 @@ using namespace cv;
             }
         }
     }
+    
+    //Tiles explored by earlier evaluations but left without tags start over unallocated.
+    grid.releaseTilesExcept([](Cell* cell) {
+        return ([cell tag] != nil) || ([cell region] != nil);
+    });
 }
 
 /*
- * Custom getter for averageTeam (lazy evaluation)
+ * Hash of every parameter that influences a team's fitness.
+ * Used to key the fitness cache so samples are never reused across different worlds.
  */
--(void) setAverageTeamFrom:(NSMutableArray*)teams {
-    averageTeam = [[Team alloc] init];
-    NSMutableDictionary* parameterSums = [[NSMutableDictionary alloc] init];
-    float tagSum = 0.f;
-    
-    for(Team* team in teams) {
-        NSMutableDictionary* parameters = [team getParameters];
-        tagSum += [team fitness];
-        for(NSString* key in parameters) {
-            float val = [[parameterSums objectForKey:key] floatValue] + [[parameters objectForKey:key] floatValue];
-            [parameterSums setObject:@(val) forKey:key];
-        }
-    }
-    
-    for(NSString* key in [parameterSums allKeys]) {
-        float val = [[parameterSums objectForKey:key] floatValue] / teamCount;
-        [parameterSums setObject:@(val) forKey:key];
-    }
-    
-    [averageTeam setFitness:(tagSum / teamCount) / evaluationCount];
-    [averageTeam setParameters:parameterSums];
+-(uint64_t) configurationHash {
+    NSString* configuration = [NSString stringWithFormat:@"%d,%d,%d,%d,%d,%d%d%d%d%d%d,%d,%d,%d,%f,%f,%f,%f,%d,%d,%@,%@,%d",
+                               robotCount, tagCount, tickCount, clusteringTagCutoff, behavior,
+                               useTravel, useGiveUp, useSiteFidelity, usePheromone, useInformedWalk, useNeighborAvoidance, neighborRadius,
+                               pheromoneModel, pheromoneUpdateInterval, pheromoneDiffusionRate,
+                               distributionRandom, distributionPowerlaw, distributionClustered,
+                               pileRadius, numberOfClusteredPiles,
+                               NSStringFromSize(gridSize), NSStringFromPoint(nest),
+                               observedError];
+    const char* bytes = [configuration UTF8String];
+    return hashBytes(bytes, strlen(bytes), FNV_OFFSET_BASIS);
 }
 
-
 /*
- * Custom getter for bestTeam (lazy evaluation)
+ * Computes population statistics for the current generation in one pass and
+ * builds averageTeam and bestTeam from them.
+ * Screened teams are left out, as their fitness was never measured (unless every team was screened).
+ * Both are new objects every time, so a delegate holding on to an earlier generation's teams keeps their values.
  */
--(void) setBestTeamFrom:(NSMutableArray*)teams {
-    bestTeam = [[Team alloc] init];
-    float maxTags = -1.;
+-(void) setStatisticsFrom:(NSMutableArray*)teams {
+    NSIndexSet* simulated = [teams indexesOfObjectsPassingTest:^BOOL(Team* team, NSUInteger index, BOOL* stop) {return ![team screened];}];
+    if([simulated count] && ([simulated count] < [teams count])) {
+        teams = [[teams objectsAtIndexes:simulated] mutableCopy];
+    }
     
-    for(Team* team in teams) {
-        if([team fitness] > maxTags) {
-            maxTags = [team fitness];
-            [bestTeam setParameters:[team getParameters]];
+    int count = (int)[teams count];
+    genomeBuffer.resize(count * TEAM_PARAMETER_COUNT);
+    fitnessBuffer.resize(count);
+    statisticsScratch.resize(count);
+    
+    //Transpose genomes into gene-major order so each gene is a contiguous column.
+    float genome[TEAM_PARAMETER_COUNT];
+    for(int i = 0; i < count; i++) {
+        Team* team = [teams objectAtIndex:i];
+        [team getGenome:genome];
+        for(int g = 0; g < TEAM_PARAMETER_COUNT; g++) {
+            genomeBuffer[g * count + i] = genome[g];
         }
+        fitnessBuffer[i] = [team fitness] / evaluationCount;
     }
     
-    [bestTeam setFitness:maxTags / evaluationCount];
+    computePopulationStatistics(genomeBuffer.data(), fitnessBuffer.data(), count, statisticsScratch.data(), &statistics);
+    
+    averageTeam = [[Team alloc] init];
+    [averageTeam setGenome:statistics.mean];
+    [averageTeam setFitness:statistics.fitnessMean];
+    
+    bestTeam = [[Team alloc] init];
+    [bestTeam setGenome:statistics.best];
+    [bestTeam setFitness:statistics.fitnessMax];
 }
 
 
@@ -642,14 +1690,26 @@ using namespace cv;
               @"tagCount" : @(tagCount),
               @"evaluationCount" : @(evaluationCount),
               @"postEvaluations" : @(postEvaluations),
+              @"keepPostEvaluationSamples" : @(keepPostEvaluationSamples),
               @"tickCount" : @(tickCount),
               @"clusteringTagCutoff" : @(clusteringTagCutoff),
+              @"seed" : @(seed),
+              @"fidelitySchedule" : (fidelitySchedule ? fidelitySchedule : @[]),
               
+              @"behavior" : @(behavior),
               @"useTravel" : @(useTravel),
               @"useGiveUp" : @(useGiveUp),
               @"useSiteFidelity" : @(useSiteFidelity),
               @"usePheromone" : @(usePheromone),
               @"useInformedWalk" : @(useInformedWalk),
+              @"useNeighborAvoidance" : @(useNeighborAvoidance),
+              @"neighborRadius" : @(neighborRadius),
+              @"useLockstep" : @(useLockstep),
+              @"domainStripCount" : @(domainStripCount),
+              @"useSteadyState" : @(useSteadyState),
+              @"pheromoneModel" : @(pheromoneModel),
+              @"pheromoneUpdateInterval" : @(pheromoneUpdateInterval),
+              @"pheromoneDiffusionRate" : @(pheromoneDiffusionRate),
               
               @"distributionRandom" : @(distributionRandom),
               @"distributionPowerlaw" : @(distributionPowerlaw),
@@ -658,10 +1718,15 @@ using namespace cv;
               @"pileRadius" : @(pileRadius),
               @"numberOfClusteredPiles": @(numberOfClusteredPiles),
               
+              @"optimizer" : @(optimizer),
               @"crossoverRate" : @(crossoverRate),
               @"mutationRate" : @(mutationRate),
               @"elitism" : @(elitism),
               
+              @"useFitnessCache" : @(useFitnessCache),
+              @"useSurrogate" : @(useSurrogate),
+              @"surrogateSimulatedFraction" : @(surrogateSimulatedFraction),
+              
               @"gridSize" : NSStringFromSize(gridSize),
               @"nest" : NSStringFromPoint(nest),
               
@@ -678,14 +1743,32 @@ using namespace cv;
     tagCount = [[parameters objectForKey:@"tagCount"] intValue];
     evaluationCount = [[parameters objectForKey:@"evaluationCount"] intValue];
     postEvaluations = [[parameters objectForKey:@"postEvaluations"] intValue];
+    if([parameters objectForKey:@"keepPostEvaluationSamples"]) {
+        keepPostEvaluationSamples = [[parameters objectForKey:@"keepPostEvaluationSamples"] boolValue];
+    }
     tickCount = [[parameters objectForKey:@"tickCount"] intValue];
     clusteringTagCutoff = [[parameters objectForKey:@"clusteringTagCutoff"] intValue];
+    seed = [[parameters objectForKey:@"seed"] unsignedIntValue];
+    fidelitySchedule = [[parameters objectForKey:@"fidelitySchedule"] count] ? [parameters objectForKey:@"fidelitySchedule"] : nil;
  
+    behavior = [[parameters objectForKey:@"behavior"] intValue];
     useTravel = [[parameters objectForKey:@"useTravel"] boolValue];
     useGiveUp = [[parameters objectForKey:@"useGiveUp"] boolValue];
     useSiteFidelity = [[parameters objectForKey:@"useSiteFidelity"] boolValue];
     usePheromone = [[parameters objectForKey:@"usePheromone"] boolValue];
     useInformedWalk = [[parameters objectForKey:@"useInformedWalk"] boolValue];
+    useNeighborAvoidance = [[parameters objectForKey:@"useNeighborAvoidance"] boolValue];
+    if([parameters objectForKey:@"neighborRadius"]) {
+        neighborRadius = [[parameters objectForKey:@"neighborRadius"] intValue];
+    }
+    useLockstep = [[parameters objectForKey:@"useLockstep"] boolValue];
+    domainStripCount = [[parameters objectForKey:@"domainStripCount"] intValue];
+    useSteadyState = [[parameters objectForKey:@"useSteadyState"] boolValue];
+    pheromoneModel = [[parameters objectForKey:@"pheromoneModel"] intValue];
+    if([parameters objectForKey:@"pheromoneUpdateInterval"]) {
+        pheromoneUpdateInterval = [[parameters objectForKey:@"pheromoneUpdateInterval"] intValue];
+    }
+    pheromoneDiffusionRate = [[parameters objectForKey:@"pheromoneDiffusionRate"] floatValue];
     
     distributionRandom = [[parameters objectForKey:@"distributionRandom"] floatValue];
     distributionPowerlaw = [[parameters objectForKey:@"distributionPowerlaw"] floatValue];
@@ -695,10 +1778,17 @@ using namespace cv;
     pileRadius = [[parameters objectForKey:@"pileRadius"] intValue];
     numberOfClusteredPiles = [[parameters objectForKey:@"numberOfClusteredPiles"] intValue];
     
+    optimizer = [[parameters objectForKey:@"optimizer"] intValue];
     crossoverRate = [[parameters objectForKey:@"crossoverRate"] floatValue];
     mutationRate = [[parameters objectForKey:@"mutationRate"] floatValue];
     elitism = [[parameters objectForKey:@"elitism"] boolValue];
     
+    useFitnessCache = [[parameters objectForKey:@"useFitnessCache"] boolValue];
+    useSurrogate = [[parameters objectForKey:@"useSurrogate"] boolValue];
+    if([parameters objectForKey:@"surrogateSimulatedFraction"]) {
+        surrogateSimulatedFraction = [[parameters objectForKey:@"surrogateSimulatedFraction"] floatValue];
+    }
+    
     gridSize = NSSizeFromString([parameters objectForKey:@"gridSize"]);
     nest = NSPointFromString([parameters objectForKey:@"nest"]);
     
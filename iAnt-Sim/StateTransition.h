@@ -0,0 +1,589 @@
+#import <Foundation/Foundation.h>
+#import "Cell.h"
+#import "Cluster.h"
+#import "EventPipeline.h"
+#import "NestField.h"
+#import "Pheromone.h"
+#import "PheromoneField.h"
+#import "Robot.h"
+#import "SensorError.h"
+#import "TagBoard.h"
+#import "TiledGrid.h"
+#import "Trace.h"
+#import "Simulation.h"
+#import "Tag.h"
+#import "Team.h"
+#import "Utilities.h"
+
+#ifdef __cplusplus
+
+#import <mutex>
+#import <vector>
+
+/*
+ * Everything the tick kernel needs that stays fixed while one team is evaluated.
+ * Built once per team so the kernel never has to message the simulation or the team for it.
+ */
+struct TransitionContext {
+    EventPipeline* events; //Carries events to the delegate; NULL if it has no observers.
+    BOOL notifyPickup; //Delegate subscriptions, resolved once instead of every event.
+    BOOL notifyPheromone;
+
+    SensorError* error;
+    NSSize gridSize;
+    NSPoint nest;
+    NestField* nestField; //Lookup table for returning robots; nil falls back to moveWithin:.
+    TagBoard* tagBoard; //Tags still available to this team.
+    PheromoneField* pheromoneField; //Used instead of the pheromone records if set (see pheromoneModel).
+
+    NeighborGrid* neighborGrid; //nil unless robots avoid each other.
+    float neighborRadius;
+
+    int robotCount; //Size of the whole swarm.
+    uint64_t* randomStates; //Per-robot generator states, indexed by robot index; NULL to draw from random().
+    TraceWriter* trace; //Receives pickups and pheromone deposits if set (the kernel must then run on one thread).
+    std::vector<int64_t>* exploredCells; //Row-major indices of cells as they become explored, for frames; NULL if none are published.
+    std::mutex* exploredCellsLock; //Guards exploredCells, as strips explore concurrently.
+    uint64_t* exploredBits; //Row-major explored flags of this team, used instead of the cells' when teams share the world; NULL otherwise.
+
+    Team* team;
+    float travelGiveUpProbability;
+    float searchGiveUpProbability;
+    float pheromoneDecayRate;
+    float pheromoneLayingRate;
+    float siteFidelityRate;
+};
+
+/*
+ * Whether this team has explored the cell at (x, y).
+ */
+static inline bool isCellExplored(Cell* cell, int x, int y, TransitionContext& context) {
+    if(context.exploredBits) {
+        int64_t i = (int64_t)y * (int64_t)context.gridSize.width + x;
+        return (context.exploredBits[i >> 6] >> (i & 63)) & 1;
+    }
+    return [cell isExplored];
+}
+
+/*
+ * Marks the cell explored, logging it for frame publishing if needed.
+ */
+static inline void exploreCell(Cell* cell, int x, int y, TransitionContext& context) {
+    if(context.exploredBits) {
+        int64_t i = (int64_t)y * (int64_t)context.gridSize.width + x;
+        context.exploredBits[i >> 6] |= 1ULL << (i & 63);
+    }
+    else {
+        [cell setIsExplored:YES];
+        QuadTree* region = [cell region];
+        if(region && ![region dirty]) {
+            [region setDirty:YES];
+        }
+    }
+    if(context.exploredCells) {
+        std::lock_guard<std::mutex> lock(*context.exploredCellsLock);
+        context.exploredCells->push_back((int64_t)y * (int64_t)context.gridSize.width + x);
+    }
+}
+
+typedef int (*TransitionKernel)(NSMutableArray* robots, TransitionContext& context, int tick,
+                                TiledGrid& grid,
+                                std::vector<PheromoneRecord>& pheromones, NSMutableArray* clusters,
+                                std::vector<NSPoint>& collectedTags);
+
+/*
+ * Picks up the (available) tag at (x, y) and records it as the robot's discovery,
+ * along with the available tags it senses around it.
+ * Each neighbor is detected independently, so only their number matters.
+ * When teams share the world (context.exploredBits) the pickup is only recorded in the team's tag board,
+ * and observers get a picked up copy of the tag instead.
+ */
+template <bool UseError>
+static inline Tag* pickUpTag(Robot* robot, int x, int y, TransitionContext& context, TiledGrid& grid) {
+    SensorError* error = context.error;
+    Tag* tag = [grid[y][x] tag];
+
+    //Perturb found tag position to simulate error
+    [robot setDiscoveredTagPosition:(UseError ? [error perturbTagPosition:[tag position] withGridSize:context.gridSize andGridCenter:context.nest] : [tag position])];
+    if(!context.exploredBits) {
+        [tag setPickedUp:YES];
+    }
+    else if(context.notifyPickup) {
+        tag = [tag copy];
+        [tag setPickedUp:YES];
+    }
+    clearTagAt(*context.tagBoard, x, y);
+
+    //Sum up all non-picked-up seeds in the moore neighbor.
+    int neighborTagCount = countTagsAround(*context.tagBoard, x, y);
+    int discoveredTagCount = 1;
+    if(UseError) {
+        for(int i = 0; i < neighborTagCount; i++) {
+            if([error detectTag]) {
+                discoveredTagCount++;
+            }
+        }
+    }
+    else {
+        discoveredTagCount += neighborTagCount;
+    }
+    [robot setDiscoveredTagCount:discoveredTagCount];
+
+    return tag;
+}
+
+/*
+ * Moves the robot one cell towards its target, using the nest field when the target is the nest.
+ */
+static inline void moveTowardTarget(Robot* robot, TransitionContext& context) {
+    if(context.nestField && NSEqualPoints([robot target], context.nest)) {
+        [robot setPosition:[context.nestField stepFrom:[robot position]]];
+    }
+    else {
+        [robot moveWithin:context.gridSize];
+    }
+}
+
+/*
+ * A behavior policy decides what one robot does in one tick:
+ *
+ *   static int step(Robot* robot, int index, int robotCount, TransitionContext& context, int tick,
+ *                   grid, pheromones, clusters, collectedTags);
+ *
+ * It returns the number of tags the robot delivered to the nest this tick (appending their positions to collectedTags).
+ * Policies are template arguments of behaviorKernel, so the chosen one is inlined into the robot loop.
+ */
+
+/*
+ * State transition case statement for robots using central-place foraging algorithm.
+ * Each feature flag of the simulation is a template parameter, so every instantiation is
+ * compiled with its disabled features removed instead of re-testing them per robot per tick.
+ * When UseError is false the sensor error model is skipped entirely (including its random draws).
+ * Nothing is allocated here unless an observer subscribed to pheromone events.
+ */
+template <bool UseTravel, bool UseGiveUp, bool UseSiteFidelity, bool UsePheromone, bool UseInformedWalk, bool UseError>
+struct CPFAPolicy {
+    static inline int step(Robot* robot, int index, int robotCount, TransitionContext& context, int tick,
+                           TiledGrid& grid,
+                           std::vector<PheromoneRecord>& pheromones, NSMutableArray* clusters,
+                           std::vector<NSPoint>& collectedTags) {
+        int collected = 0;
+        SensorError* error = context.error;
+        NSSize gridSize = context.gridSize;
+        NSPoint nest = context.nest;
+
+        switch([robot status]) {
+
+            /*
+             * The robot hasn't been initialized yet.
+             * Give it some basic starting values and then fall-through to the next state.
+             */
+            case ROBOT_STATUS_INACTIVE: {
+                [robot setStatus:ROBOT_STATUS_DEPARTING];
+                [robot setPosition:nest];
+                [robot setTarget:edge(gridSize)];
+                //Fallthrough to ROBOT_STATUS_DEPARTING.
+            }
+
+            /*
+             * The robot is either:
+             *  -Moving in a random direction away from the nest (not site-fidelity-ing or pheromone-ing).
+             *  -Moving towards a specific point where a tag was last found (site-fidelity-ing).
+             *  -Moving towards a specific point due to pheromones.
+             *
+             * For each of the cases, we have to ultimately decide on a direction for the robot to travel in,
+             * then decide which 'cell' best accomplishes traveling in this direction.  We then move the robot,
+             * and may change the robot/world state based on certain criteria (i.e. it reaches its destination).
+             */
+            case ROBOT_STATUS_DEPARTING: {
+
+                //Delay to emulate physical robot
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                if((![robot informed] && (!UseTravel || (randomFloat(1.) < context.travelGiveUpProbability))) || (NSEqualPoints([robot position], [robot target]))) {
+                    [robot setStatus:ROBOT_STATUS_SEARCHING];
+                    [robot setInformed:((int)UseInformedWalk & [robot informed])];
+                    [robot turnWithParameters:context.team];
+                    break;
+                }
+
+                [robot moveWithin:gridSize];
+                break;
+            }
+
+            /*
+             * The robot is performing a random walk.
+             * It will randomly change its direction based on how long it has been searching and move in this direction.
+             * If it finds a tag, its state changes to ROBOT_STATUS_RETURNING (it brings the tag back to the nest.
+             * All site fidelity and pheromone work, however, is taken care of once the robot actually arrives at the nest.
+             */
+            case ROBOT_STATUS_SEARCHING: {
+
+                //Delay to emulate physical robot
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                //Probabilistically give up searching and return to the nest
+                if(UseGiveUp && (randomFloat(1.) < context.searchGiveUpProbability)) {
+                    [robot setTarget:nest];
+                    [robot setStatus:ROBOT_STATUS_RETURNING];
+                    break;
+                }
+
+                //Steer away from the closest robot we can sense
+                if(context.neighborGrid) {
+                    NSPoint neighborPosition;
+                    if([context.neighborGrid nearestNeighborOfRobot:[robot index] withinRadius:context.neighborRadius position:&neighborPosition] &&
+                       (!UseError || [error detectNeighbor])) {
+                        //A robot on the same cell gives no direction to flee in, so pick one at random.
+                        if(NSEqualPoints([robot position], neighborPosition)) {
+                            [robot setDirection:randomFloat(M_2PI)];
+                        }
+                        else {
+                            [robot setDirection:pmod(atan2f([robot position].y - neighborPosition.y, [robot position].x - neighborPosition.x), M_2PI)];
+                        }
+                    }
+                }
+
+                //Calculate end point
+                [robot setTarget:NSMakePoint(roundf([robot position].x + (cos(robot.direction))), roundf([robot position].y + (sin([robot direction]))))];
+
+                //If our current direction takes us outside the world, frantically spin around until this isn't the case.
+                while([robot target].x < 0 || [robot target].y < 0 || [robot target].x >= gridSize.width || [robot target].y >= gridSize.height) {
+                    [robot setDirection:randomFloat(M_2PI)];
+                    [robot setTarget:NSMakePoint(roundf([robot position].x + cos([robot direction])), roundf([robot position].y + sin([robot direction])))];
+                }
+
+                //Move one cell
+                [robot moveWithin:gridSize];
+                Cell* currentCell = grid[[robot position].y][[robot position].x];
+                if (!isCellExplored(currentCell, [robot position].x, [robot position].y, context)) {
+                    exploreCell(currentCell, [robot position].x, [robot position].y, context);
+                }
+
+                //Turn
+                [robot turnWithParameters:context.team];
+
+                //After we've moved 1 square ahead, check one square ahead for a tag.
+                //Reusing robot.target here (without consequence, it just gets overwritten when moving).
+                [robot setTarget:NSMakePoint(roundf([robot position].x + cos([robot direction])), roundf([robot position].y + sin([robot direction])))];
+                int aheadX = [robot target].x, aheadY = [robot target].y;
+                if(aheadX >= 0 && aheadY >= 0 && aheadX < gridSize.width && aheadY < gridSize.height) {
+                    //Note we use shortcircuiting here.
+                    if((!UseError || [error detectTag]) && hasTagAt(*context.tagBoard, aheadX, aheadY)) {
+                        Tag* foundTag = pickUpTag<UseError>(robot, aheadX, aheadY, context, grid);
+                        if(context.trace) {
+                            context.trace->recordPickup([robot index], aheadX, aheadY);
+                        }
+
+                        [robot setStatus:ROBOT_STATUS_RETURNING];
+                        [robot setDelay:9];
+                        [robot setTarget:nest];
+
+                        if(context.notifyPickup) {
+                            SimulationEvent event = {SimulationEventPickup, tick, [foundTag position], [foundTag cluster], 0., 0.,
+                                                     (void*)CFBridgingRetain(foundTag)};
+                            context.events->push(event);
+                        }
+                    }
+                }
+
+                break;
+            }
+
+            /*
+             * The robot is on its way back to the nest.
+             * It is either carrying food, or it gave up on its search and is returning to base for further instruction.
+             * Stuff like laying/assigning of pheromones is handled here.
+             */
+            case ROBOT_STATUS_RETURNING: {
+
+                //Delay to emulate physical robot
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                moveTowardTarget(robot, context);
+
+                if(NSEqualPoints(robot.position, nest)) {
+                    //Retrieve collected tag (if available)
+                    int discoveredTagCount = [robot discoveredTagCount];
+                    BOOL foundTag = (discoveredTagCount > 0);
+                    NSPoint foundTagPosition = [robot discoveredTagPosition];
+                    if (foundTag) {
+                        collectedTags.push_back(foundTagPosition);
+                        collected++;
+                    }
+
+                    //Add (perturbed) tag position to global pheromone array
+                    if (foundTag && (randomFloat(1.) < poissonCDF(discoveredTagCount, context.pheromoneLayingRate))) {
+                        if(context.pheromoneField) {
+                            context.pheromoneField->deposit(foundTagPosition, 1.);
+                        }
+                        else {
+                            PheromoneRecord pheromone = {foundTagPosition, 1., context.pheromoneDecayRate, tick};
+                            pheromones.push_back(pheromone);
+                        }
+
+                        if(context.trace) {
+                            context.trace->recordPheromone(foundTagPosition.x, foundTagPosition.y, 1.);
+                        }
+
+                        //Observers get the pheromone as laid; the simulation never touches this object again.
+                        if(context.notifyPheromone) {
+                            Pheromone* observed = [[Pheromone alloc] initWithPosition:foundTagPosition weight:1. decayRate:context.pheromoneDecayRate andUpdatedTick:tick];
+                            SimulationEvent event = {SimulationEventPheromone, tick, foundTagPosition, 0, 1., context.pheromoneDecayRate,
+                                                     (void*)CFBridgingRetain(observed)};
+                            context.events->push(event);
+                        }
+                    }
+
+                    //Set required local variables
+                    BOOL decisionFlag = randomFloat(1.) < poissonCDF(discoveredTagCount, context.siteFidelityRate);
+                    NSPoint pheromonePosition = NSNullPoint;
+                    if(UsePheromone) {
+                        pheromonePosition = context.pheromoneField ? context.pheromoneField->sample() : samplePheromone(pheromones, tick);
+                    }
+                    else if(!context.pheromoneField) {
+                        //Nobody follows them, but the sample's random draw is kept so seeded runs match the unspecialized
+                        //kernel; sampling also drops the decayed records, which are still laid (and observed).
+                        samplePheromone(pheromones, tick);
+                    }
+
+                    if([clusters count]) {
+                        int r = randomInt((int)[clusters count]);
+                        Cluster* target = [clusters objectAtIndex:r];
+                        int x = clip(randomIntRange([target center].x - [target width]/2, [target center].x + [target width]/2), 0, gridSize.width - 1);
+                        int y = clip(randomIntRange([target center].y - [target height]/2, [target center].y + [target height]/2), 0, gridSize.height - 1);
+                        [robot setTarget:NSMakePoint(x, y)];
+                        [robot setInformed:ROBOT_INFORMED_PHEROMONE];
+                    }
+
+                    //If a tag was found, decide whether to return to its location
+                    else if(UseSiteFidelity && foundTag && decisionFlag) {
+                        [robot setTarget:(UseError ? [error perturbTargetPosition:foundTagPosition withGridSize:gridSize andGridCenter:nest] : foundTagPosition)];
+                        [robot setInformed:ROBOT_INFORMED_MEMORY];
+                    }
+
+                    //If no pheromones exist, pheromone will be (-1, -1)
+                    else if(UsePheromone && !NSEqualPoints(pheromonePosition, NSNullPoint) && !decisionFlag) {
+                        [robot setTarget:(UseError ? [error perturbTargetPosition:pheromonePosition withGridSize:gridSize andGridCenter:nest] : pheromonePosition)];
+                        [robot setInformed:ROBOT_INFORMED_PHEROMONE];
+                    }
+
+                    //If no pheromones and no tag and no partitioning knowledge, go to a random location
+                    else {
+                        [robot setTarget:edge(gridSize)];
+                        [robot setInformed:ROBOT_INFORMED_NONE];
+                    }
+
+                    [robot setDiscoveredTagCount:0];
+                    [robot setSearchTime:0];
+                    [robot setStatus:ROBOT_STATUS_DEPARTING];
+                }
+                break;
+            }
+        }
+
+        return collected;
+    }
+};
+
+/*
+ * Interleaved square spiral search around the nest, a deterministic alternative to CPFA's correlated random walk.
+ * All spirals have legs n, n, 2n, 2n, 3n, ... for n robots and robot i starts i cells diagonally from the nest,
+ * so together the swarm sweeps every row and column around the nest once per lap.
+ * Robots return each tag to the nest and resume their spiral where they found it; the team's evolved
+ * parameters are not used.
+ *
+ * searchTime counts spiral legs and waypoint holds the end of the current leg.
+ */
+template <bool UseError>
+struct SpiralSearchPolicy {
+    static inline int step(Robot* robot, int index, int robotCount, TransitionContext& context, int tick,
+                           TiledGrid& grid,
+                           std::vector<PheromoneRecord>& pheromones, NSMutableArray* clusters,
+                           std::vector<NSPoint>& collectedTags) {
+        static const int legX[4] = {0, 1, 0, -1};
+        static const int legY[4] = {1, 0, -1, 0};
+
+        int collected = 0;
+        SensorError* error = context.error;
+        NSSize gridSize = context.gridSize;
+        NSPoint nest = context.nest;
+
+        switch([robot status]) {
+
+            //Start (or restart) the spiral.
+            case ROBOT_STATUS_INACTIVE: {
+                NSPoint start = NSMakePoint(clip(nest.x + index, 0, gridSize.width - 1), clip(nest.y + index, 0, gridSize.height - 1));
+                [robot setPosition:nest];
+                [robot setTarget:start];
+                [robot setWaypoint:start];
+                [robot setSearchTime:0];
+                [robot setStatus:ROBOT_STATUS_DEPARTING];
+                //Fallthrough to ROBOT_STATUS_DEPARTING.
+            }
+
+            //Travel to where the spiral starts or was left off.
+            case ROBOT_STATUS_DEPARTING: {
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                if(NSEqualPoints([robot position], [robot target])) {
+                    [robot setStatus:ROBOT_STATUS_SEARCHING];
+                    break;
+                }
+
+                moveTowardTarget(robot, context);
+                break;
+            }
+
+            case ROBOT_STATUS_SEARCHING: {
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                //Start the next leg, skipping legs that lie entirely outside the world.
+                int maxLegLength = 2 * MAX(gridSize.width, gridSize.height);
+                while(NSEqualPoints([robot position], [robot waypoint])) {
+                    int leg = [robot searchTime];
+                    int length = robotCount * ((leg / 2) + 1);
+                    if(length > maxLegLength) {
+                        //Spiral has covered the world; go home and start over.
+                        [robot setStatus:ROBOT_STATUS_RETURNING];
+                        [robot setTarget:nest];
+                        return collected;
+                    }
+                    [robot setWaypoint:NSMakePoint(clip([robot position].x + (legX[leg % 4] * length), 0, gridSize.width - 1),
+                                                   clip([robot position].y + (legY[leg % 4] * length), 0, gridSize.height - 1))];
+                    [robot setSearchTime:leg + 1];
+                }
+
+                //Move one cell along the leg (x first if we are off it after resuming).
+                NSPoint position = [robot position];
+                NSPoint waypoint = [robot waypoint];
+                if(position.x != waypoint.x) {
+                    position.x += (waypoint.x > position.x) ? 1 : -1;
+                }
+                else {
+                    position.y += (waypoint.y > position.y) ? 1 : -1;
+                }
+                [robot setPosition:position];
+
+                Cell* currentCell = grid[position.y][position.x];
+                if (!isCellExplored(currentCell, position.x, position.y, context)) {
+                    exploreCell(currentCell, position.x, position.y, context);
+                }
+
+                if((!UseError || [error detectTag]) && hasTagAt(*context.tagBoard, position.x, position.y)) {
+                    Tag* foundTag = pickUpTag<UseError>(robot, position.x, position.y, context, grid);
+                    if(context.trace) {
+                        context.trace->recordPickup([robot index], position.x, position.y);
+                    }
+
+                    [robot setStatus:ROBOT_STATUS_RETURNING];
+                    [robot setDelay:9];
+                    [robot setTarget:nest];
+
+                    if(context.notifyPickup) {
+                        SimulationEvent event = {SimulationEventPickup, tick, [foundTag position], [foundTag cluster], 0., 0.,
+                                                 (void*)CFBridgingRetain(foundTag)};
+                        context.events->push(event);
+                    }
+                }
+                break;
+            }
+
+            case ROBOT_STATUS_RETURNING: {
+                if([robot delay]) {
+                    [robot setDelay:[robot delay] - 1];
+                    break;
+                }
+
+                moveTowardTarget(robot, context);
+
+                if(NSEqualPoints([robot position], nest)) {
+                    if([robot discoveredTagCount] > 0) {
+                        collectedTags.push_back([robot discoveredTagPosition]);
+                        collected = 1;
+
+                        //Resume the spiral where the tag was found.
+                        NSPoint resume = [robot discoveredTagPosition];
+                        [robot setTarget:NSMakePoint(clip(resume.x, 0, gridSize.width - 1), clip(resume.y, 0, gridSize.height - 1))];
+                        [robot setDiscoveredTagCount:0];
+                        [robot setStatus:ROBOT_STATUS_DEPARTING];
+                    }
+                    else {
+                        [robot setStatus:ROBOT_STATUS_INACTIVE];
+                    }
+                }
+                break;
+            }
+        }
+
+        return collected;
+    }
+};
+
+/*
+ * Runs one tick of Policy for every robot and returns the number of tags delivered.
+ * robots may be any subset of the swarm (e.g. one strip of the world); robots are identified by their index.
+ */
+template <class Policy>
+int behaviorKernel(NSMutableArray* robots, TransitionContext& context, int tick,
+                   TiledGrid& grid,
+                   std::vector<PheromoneRecord>& pheromones, NSMutableArray* clusters,
+                   std::vector<NSPoint>& collectedTags) {
+    int collected = 0;
+    for (Robot* robot in robots) {
+        if(context.randomStates) {
+            threadRandomState = &context.randomStates[[robot index]];
+        }
+        collected += Policy::step(robot, [robot index], context.robotCount, context, tick, grid, pheromones, clusters, collectedTags);
+    }
+    threadRandomState = NULL;
+    return collected;
+}
+
+/*
+ * Binds one feature flag per level of recursion; the fully bound case returns the instantiated kernel.
+ */
+template <bool... Flags>
+struct TransitionKernelTable {
+    static TransitionKernel select(const bool* flags) {
+        return flags[sizeof...(Flags)] ? TransitionKernelTable<Flags..., true>::select(flags)
+                                       : TransitionKernelTable<Flags..., false>::select(flags);
+    }
+};
+
+template <bool UseTravel, bool UseGiveUp, bool UseSiteFidelity, bool UsePheromone, bool UseInformedWalk, bool UseError>
+struct TransitionKernelTable<UseTravel, UseGiveUp, UseSiteFidelity, UsePheromone, UseInformedWalk, UseError> {
+    static TransitionKernel select(const bool* flags) {
+        return &behaviorKernel<CPFAPolicy<UseTravel, UseGiveUp, UseSiteFidelity, UsePheromone, UseInformedWalk, UseError>>;
+    }
+};
+
+/*
+ * Returns the kernel instantiated for the given behavior (see Constants.h) and combination of feature flags.
+ * The CPFA feature flags are ignored by other behaviors.
+ */
+static inline TransitionKernel selectTransitionKernel(int behavior, BOOL useTravel, BOOL useGiveUp, BOOL useSiteFidelity, BOOL usePheromone, BOOL useInformedWalk, BOOL useError) {
+    if(behavior == SpiralSearchBehaviorId) {
+        return useError ? &behaviorKernel<SpiralSearchPolicy<true>> : &behaviorKernel<SpiralSearchPolicy<false>>;
+    }
+
+    const bool flags[] = {(bool)useTravel, (bool)useGiveUp, (bool)useSiteFidelity, (bool)usePheromone, (bool)useInformedWalk, (bool)useError};
+    return TransitionKernelTable<>::select(flags);
+}
+
+#endif
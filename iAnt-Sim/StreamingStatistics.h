@@ -0,0 +1,175 @@
+#import <Foundation/Foundation.h>
+#import "PopulationStatistics.h"
+
+#ifdef __cplusplus
+
+#import <algorithm>
+#import <cmath>
+#import <vector>
+
+#define STREAMING_HISTOGRAM_BIN_COUNT 32
+
+/*
+ * Running estimate of one quantile in constant memory (the P-square algorithm of Jain and Chlamtac).
+ * Five markers track the minimum, the quantile, the maximum and the quantiles halfway between;
+ * each observation moves the inner markers towards their ideal positions along a piecewise-parabolic fit.
+ */
+class QuantileSketch {
+    double p;
+    long long count;
+    double heights[5];
+    double positions[5];
+    double desired[5];
+    double increments[5];
+
+    double parabolic(int i, double d) const {
+        return heights[i] + (d / (positions[i + 1] - positions[i - 1])) *
+               ((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+                (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+    }
+
+public:
+    QuantileSketch(double _p = 0.5) : p(_p), count(0) {
+        double initialDesired[5] = {1., 1. + (2. * p), 1. + (4. * p), 3. + (2. * p), 5.};
+        double initialIncrements[5] = {0., p / 2., p, (1. + p) / 2., 1.};
+        for(int i = 0; i < 5; i++) {
+            positions[i] = i + 1;
+            desired[i] = initialDesired[i];
+            increments[i] = initialIncrements[i];
+        }
+    }
+
+    void add(double x) {
+        //The first five observations become the markers.
+        if(count < 5) {
+            heights[count++] = x;
+            std::sort(heights, heights + count);
+            return;
+        }
+        count++;
+
+        int k;
+        if(x < heights[0]) {
+            heights[0] = x;
+            k = 0;
+        }
+        else if(x >= heights[4]) {
+            heights[4] = x;
+            k = 3;
+        }
+        else {
+            k = 0;
+            while(x >= heights[k + 1]){k++;}
+        }
+
+        for(int i = k + 1; i < 5; i++) {
+            positions[i]++;
+        }
+        for(int i = 0; i < 5; i++) {
+            desired[i] += increments[i];
+        }
+
+        for(int i = 1; i < 4; i++) {
+            double d = desired[i] - positions[i];
+            if(((d >= 1.) && (positions[i + 1] - positions[i] > 1.)) || ((d <= -1.) && (positions[i - 1] - positions[i] < -1.))) {
+                d = (d > 0.) ? 1. : -1.;
+                double height = parabolic(i, d);
+                if((heights[i - 1] < height) && (height < heights[i + 1])) {
+                    heights[i] = height;
+                }
+                else {
+                    int j = i + (int)d;
+                    heights[i] += d * (heights[j] - heights[i]) / (positions[j] - positions[i]);
+                }
+                positions[i] += d;
+            }
+        }
+    }
+
+    /*
+     * Exact (nearest rank) up to the fifth observation (the markers are still the sorted observations), an estimate from then on.
+     */
+    double value() const {
+        if(count == 0) {
+            return 0.;
+        }
+        if(count <= 5) {
+            return heights[(int)lround(p * (count - 1))];
+        }
+        return heights[2];
+    }
+};
+
+/*
+ * Constant-memory summary of a stream of values: count, mean and variance (Welford's method), range,
+ * the PopulationQuantiles quantiles and a histogram of STREAMING_HISTOGRAM_BIN_COUNT equal bins over [lower, upper]
+ * (values outside fall into the end bins).
+ */
+class StreamingStatistics {
+    long long count;
+    double mean;
+    double squaredDeviations;
+    double minimum;
+    double maximum;
+    QuantileSketch quantiles[POPULATION_QUANTILE_COUNT];
+    double lower;
+    double upper;
+    std::vector<long long> bins;
+
+public:
+    StreamingStatistics(double _lower, double _upper) : count(0), mean(0.), squaredDeviations(0.), minimum(0.), maximum(0.),
+                                                        lower(_lower), upper(std::max(_upper, _lower + 1.)), bins(STREAMING_HISTOGRAM_BIN_COUNT, 0) {
+        for(int q = 0; q < POPULATION_QUANTILE_COUNT; q++) {
+            quantiles[q] = QuantileSketch(PopulationQuantiles[q]);
+        }
+    }
+
+    void add(double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        squaredDeviations += delta * (x - mean);
+        minimum = (count == 1) ? x : std::min(minimum, x);
+        maximum = (count == 1) ? x : std::max(maximum, x);
+
+        for(int q = 0; q < POPULATION_QUANTILE_COUNT; q++) {
+            quantiles[q].add(x);
+        }
+
+        int bin = (int)floor((x - lower) / (upper - lower) * STREAMING_HISTOGRAM_BIN_COUNT);
+        bins[std::min(std::max(bin, 0), STREAMING_HISTOGRAM_BIN_COUNT - 1)]++;
+    }
+
+    long long getCount() const {return count;}
+    double getMean() const {return mean;}
+    double getVariance() const {return (count > 1) ? squaredDeviations / (count - 1) : 0.;}
+    double getMin() const {return minimum;}
+    double getMax() const {return maximum;}
+    double getQuantile(int q) const {return quantiles[q].value();}
+    double getLower() const {return lower;}
+    double getUpper() const {return upper;}
+    const std::vector<long long>& getBins() const {return bins;}
+};
+
+/*
+ * Boxes a summary for result dictionaries; quantiles are keyed by their PopulationQuantiles value.
+ */
+static inline NSDictionary* dictionaryFromStatistics(const StreamingStatistics& statistics) {
+    NSMutableDictionary* quantiles = [[NSMutableDictionary alloc] init];
+    for(int q = 0; q < POPULATION_QUANTILE_COUNT; q++) {
+        [quantiles setObject:@(statistics.getQuantile(q)) forKey:[NSString stringWithFormat:@"%g", PopulationQuantiles[q]]];
+    }
+    NSMutableArray* bins = [[NSMutableArray alloc] initWithCapacity:statistics.getBins().size()];
+    for(long long bin : statistics.getBins()) {
+        [bins addObject:@(bin)];
+    }
+    return @{@"count":@(statistics.getCount()),
+             @"mean":@(statistics.getMean()),
+             @"variance":@(statistics.getVariance()),
+             @"min":@(statistics.getMin()),
+             @"max":@(statistics.getMax()),
+             @"quantiles":quantiles,
+             @"histogram":@{@"lower":@(statistics.getLower()), @"upper":@(statistics.getUpper()), @"bins":bins}};
+}
+
+#endif
@@ -1,4 +1,5 @@
 #import "Tag.h"
+#import "MemoryMonitor.h"
 
 @implementation Tag
 
@@ -6,6 +7,15 @@
 @synthesize pickedUp, discovered;
 @synthesize cluster;
 
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassTag);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassTag);
+}
+
 -(id) initWithX:(int)_x Y:(int)_y andCluster:(int)_cluster {
     if(self = [super init]) {
         position = NSMakePoint(_x, _y);
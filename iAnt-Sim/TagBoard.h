@@ -0,0 +1,116 @@
+#import <Foundation/Foundation.h>
+#import "Tag.h"
+#import "TiledGrid.h"
+
+#ifdef __cplusplus
+
+#import <vector>
+
+typedef uint32_t TagBoardRow; //One row of a tile, a bit per cell.
+static_assert(sizeof(TagBoardRow) * 8 == GRID_TILE_SIZE, "TagBoardRow must hold one row of a grid tile");
+
+/*
+ * One bit per grid cell, set while the cell holds a tag that has not been picked up.
+ * Bits are kept per grid tile, and only tiles that ever held a tag have storage,
+ * so copying a board for every team costs in proportion to the tags rather than the world.
+ */
+struct TagBoard {
+    int width;
+    int height;
+    int tileColumns;
+    int tileRows;
+    std::vector<int> tileOffsets; //Index of each tile's first row in rows, -1 if the tile has no storage.
+    std::vector<TagBoardRow> rows;
+};
+
+static inline void initTagBoard(TagBoard& board, int width, int height) {
+    board.width = width;
+    board.height = height;
+    board.tileColumns = (width + GRID_TILE_SIZE - 1) >> GRID_TILE_SHIFT;
+    board.tileRows = (height + GRID_TILE_SIZE - 1) >> GRID_TILE_SHIFT;
+    board.tileOffsets.assign((size_t)board.tileColumns * board.tileRows, -1);
+    board.rows.clear();
+}
+
+/*
+ * Returns the row of tile column tileX holding y, or an empty row outside the world or if the tile has no storage.
+ */
+static inline TagBoardRow tagRowAt(const TagBoard& board, int tileX, int y) {
+    if(tileX < 0 || tileX >= board.tileColumns || y < 0 || y >= board.height) {
+        return 0;
+    }
+    int offset = board.tileOffsets[(y >> GRID_TILE_SHIFT) * board.tileColumns + tileX];
+    return (offset < 0) ? 0 : board.rows[offset + (y & (GRID_TILE_SIZE - 1))];
+}
+
+static inline bool hasTagAt(const TagBoard& board, int x, int y) {
+    return (tagRowAt(board, x >> GRID_TILE_SHIFT, y) >> (x & (GRID_TILE_SIZE - 1))) & 1;
+}
+
+static inline void setTagAt(TagBoard& board, int x, int y) {
+    int& offset = board.tileOffsets[(y >> GRID_TILE_SHIFT) * board.tileColumns + (x >> GRID_TILE_SHIFT)];
+    if(offset < 0) {
+        offset = (int)board.rows.size();
+        board.rows.resize(board.rows.size() + GRID_TILE_SIZE, 0);
+    }
+    board.rows[offset + (y & (GRID_TILE_SIZE - 1))] |= (TagBoardRow)1 << (x & (GRID_TILE_SIZE - 1));
+}
+
+/*
+ * Never allocates, so robots in different tiles may clear tags concurrently.
+ */
+static inline void clearTagAt(TagBoard& board, int x, int y) {
+    int offset = board.tileOffsets[(y >> GRID_TILE_SHIFT) * board.tileColumns + (x >> GRID_TILE_SHIFT)];
+    if(offset >= 0) {
+        board.rows[offset + (y & (GRID_TILE_SIZE - 1))] &= ~((TagBoardRow)1 << (x & (GRID_TILE_SIZE - 1)));
+    }
+}
+
+/*
+ * Returns the bits for cells (x - 1 ... x + 1, y) in the low three bits.
+ */
+static inline uint32_t tagWindowAt(const TagBoard& board, int x, int y) {
+    int tileX = x >> GRID_TILE_SHIFT;
+    int column = x & (GRID_TILE_SIZE - 1);
+    TagBoardRow row = tagRowAt(board, tileX, y);
+    if(column == 0) {
+        return ((row & 3) << 1) | ((tagRowAt(board, tileX - 1, y) >> (GRID_TILE_SIZE - 1)) & 1);
+    }
+    if(column == GRID_TILE_SIZE - 1) {
+        return ((row >> (GRID_TILE_SIZE - 2)) & 3) | ((tagRowAt(board, tileX + 1, y) & 1) << 2);
+    }
+    return (row >> (column - 1)) & 7;
+}
+
+/*
+ * Number of available tags in the Moore neighborhood of (x, y), including (x, y) itself.
+ */
+static inline int countTagsAround(const TagBoard& board, int x, int y) {
+    return __builtin_popcount(tagWindowAt(board, x, y - 1) | (tagWindowAt(board, x, y) << 3) | (tagWindowAt(board, x, y + 1) << 6));
+}
+
+/*
+ * Number of tags still available on the whole board; only words of tiles that ever held a tag are counted.
+ */
+static inline int countRemainingTags(const TagBoard& board) {
+    int count = 0;
+    for(TagBoardRow row : board.rows) {
+        count += __builtin_popcount(row);
+    }
+    return count;
+}
+
+/*
+ * Fills board from the tags in grid that have not been picked up.
+ */
+static inline void tagBoardFromGrid(TagBoard& board, const TiledGrid& grid) {
+    initTagBoard(board, grid.width(), grid.height());
+    grid.forEachCell([&board](Cell* cell, int x, int y) {
+        Tag* tag = [cell tag];
+        if(tag && ![tag pickedUp]) {
+            setTagAt(board, x, y);
+        }
+    });
+}
+
+#endif
@@ -2,11 +2,17 @@
 #import "Archivable.h"
 #import "Utilities.h"
 
+#define TEAM_PARAMETER_COUNT 7 //Number of evolved parameters (see getGenome: for ordering).
+
 @interface Team : NSObject <Archivable> {}
 
 -(id) initRandom;
 -(id) initWithFile:(NSString*)filePath;
 
+-(void) getGenome:(float*)genome;
+-(void) setGenome:(const float*)genome;
++(void) getGenomeLowerBounds:(float*)lower upperBounds:(float*)upper;
+
 //Behavior parameters:
 @property (nonatomic) float travelGiveUpProbability;
 @property (nonatomic) float searchGiveUpProbability;
@@ -22,6 +28,7 @@
 
 //Non-evolved variables:
 @property (nonatomic) float fitness;
+@property (nonatomic) BOOL screened; //fitness is the surrogate's prediction rather than simulated (see Simulation's useSurrogate).
 @property (nonatomic) int timeToCompleteCollection;
 @property (nonatomic) int predictedClusters;
 
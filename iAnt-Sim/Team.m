@@ -1,11 +1,21 @@
 #import "Team.h"
+#import "MemoryMonitor.h"
 
 @implementation Team
 
 @synthesize travelGiveUpProbability, searchGiveUpProbability;
 @synthesize uninformedSearchCorrelation, informedSearchCorrelationDecayRate;
 @synthesize pheromoneDecayRate, pheromoneLayingRate, siteFidelityRate;
-@synthesize fitness, timeToCompleteCollection, predictedClusters;
+@synthesize fitness, screened, timeToCompleteCollection, predictedClusters;
+
++(id) allocWithZone:(NSZone*)zone {
+    trackAllocation(MemoryClassTeam);
+    return [super allocWithZone:zone];
+}
+
+-(void) dealloc {
+    trackDeallocation(MemoryClassTeam);
+}
 
 -(id) initRandom {
     if(self = [super init]) {
@@ -35,6 +45,47 @@
     return self;
 }
 
+/*
+ * Copies the evolved parameters into a flat array of TEAM_PARAMETER_COUNT floats.
+ * Uses the same ordering as writeParametersToFile: so genomes can be compared without boxing.
+ */
+-(void) getGenome:(float*)genome {
+    genome[0] = pheromoneDecayRate;
+    genome[1] = travelGiveUpProbability;
+    genome[2] = searchGiveUpProbability;
+    genome[3] = uninformedSearchCorrelation;
+    genome[4] = informedSearchCorrelationDecayRate;
+    genome[5] = pheromoneLayingRate;
+    genome[6] = siteFidelityRate;
+}
+
+-(void) setGenome:(const float*)genome {
+    pheromoneDecayRate = genome[0];
+    travelGiveUpProbability = genome[1];
+    searchGiveUpProbability = genome[2];
+    uninformedSearchCorrelation = genome[3];
+    informedSearchCorrelationDecayRate = genome[4];
+    pheromoneLayingRate = genome[5];
+    siteFidelityRate = genome[6];
+}
+
+/*
+ * Fills lower and upper with the range initRandom draws each gene from, in getGenome: order.
+ * Exponentially distributed genes are capped at 1, which covers nearly all of their probability mass.
+ */
++(void) getGenomeLowerBounds:(float*)lower upperBounds:(float*)upper {
+    for(int g = 0; g < TEAM_PARAMETER_COUNT; g++) {
+        lower[g] = 0.;
+    }
+    upper[0] = 1.; //pheromoneDecayRate
+    upper[1] = 1.; //travelGiveUpProbability
+    upper[2] = 1.; //searchGiveUpProbability
+    upper[3] = 2 * M_2PI; //uninformedSearchCorrelation
+    upper[4] = 1.; //informedSearchCorrelationDecayRate
+    upper[5] = 20.; //pheromoneLayingRate
+    upper[6] = 20.; //siteFidelityRate
+}
+
 
 #pragma Archivable methods
 
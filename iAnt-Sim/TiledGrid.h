@@ -0,0 +1,131 @@
+#import <Foundation/Foundation.h>
+#import "Cell.h"
+
+#ifdef __cplusplus
+
+#import <atomic>
+#import <memory>
+#import <mutex>
+#import <vector>
+
+#define GRID_TILE_SHIFT 5
+#define GRID_TILE_SIZE (1 << GRID_TILE_SHIFT) //Tiles are GRID_TILE_SIZE x GRID_TILE_SIZE cells.
+
+/*
+ * World of Cells stored as square tiles that are only allocated when one of their cells is first touched
+ * (by a robot or by tag placement), so memory follows the explored part of the world rather than its size.
+ *
+ * grid[y][x] works as it did for the dense vector<vector<Cell*>> grid, allocating the tile if needed.
+ * Copies are handles to the same cells, just as copying the dense grid copied pointers to them.
+ */
+class TiledGrid {
+    struct Storage {
+        int width;
+        int height;
+        int tileColumns;
+        std::vector<std::vector<Cell*>> tiles; //Empty until allocated.
+        std::vector<int> allocatedTiles; //Indices into tiles, in order of allocation.
+        std::mutex allocationLock; //Guards allocatedTiles; workers allocating distinct tiles may run concurrently.
+        uint64_t releaseCount = 0; //Bumped whenever tiles are freed, so holders of Cell pointers know to drop them.
+        std::atomic<uint64_t> layoutCount{0}; //Bumped whenever tags are laid out anew, so copies of the tags know to rebuild.
+    };
+
+    std::shared_ptr<Storage> storage;
+
+    static Cell* cellAt(Storage& storage, int x, int y) {
+        int tile = (y >> GRID_TILE_SHIFT) * storage.tileColumns + (x >> GRID_TILE_SHIFT);
+        std::vector<Cell*>& cells = storage.tiles[tile];
+        if(cells.empty()) {
+            cells.resize(GRID_TILE_SIZE * GRID_TILE_SIZE);
+            for(Cell*& cell : cells) {
+                cell = [[Cell alloc] init];
+            }
+            std::lock_guard<std::mutex> lock(storage.allocationLock);
+            storage.allocatedTiles.push_back(tile);
+        }
+        return cells[((y & (GRID_TILE_SIZE - 1)) << GRID_TILE_SHIFT) + (x & (GRID_TILE_SIZE - 1))];
+    }
+
+public:
+    class Row {
+        Storage* storage;
+        int y;
+
+    public:
+        Row(Storage* _storage, int _y) : storage(_storage), y(_y) {}
+        Cell* operator[](int x) const {return cellAt(*storage, x, y);}
+    };
+
+    TiledGrid() {}
+
+    TiledGrid(int width, int height) : storage(std::make_shared<Storage>()) {
+        storage->width = width;
+        storage->height = height;
+        storage->tileColumns = (width + GRID_TILE_SIZE - 1) >> GRID_TILE_SHIFT;
+        storage->tiles.resize(storage->tileColumns * ((height + GRID_TILE_SIZE - 1) >> GRID_TILE_SHIFT));
+    }
+
+    int width() const {return storage ? storage->width : 0;}
+    int height() const {return storage ? storage->height : 0;}
+    size_t size() const {return height();} //Number of rows, as for the dense grid.
+
+    Row operator[](int y) const {return Row(storage.get(), y);}
+
+    /*
+     * Calls function(cell, x, y) for every cell inside the world in an allocated tile.
+     * Cells of untouched tiles are all in their initial state, so resets and scans can skip them.
+     */
+    template <class Function>
+    void forEachCell(Function function) const {
+        for(int tile : storage->allocatedTiles) {
+            const std::vector<Cell*>& cells = storage->tiles[tile];
+            int originX = (tile % storage->tileColumns) << GRID_TILE_SHIFT;
+            int originY = (tile / storage->tileColumns) << GRID_TILE_SHIFT;
+            for(int i = 0; i < GRID_TILE_SIZE * GRID_TILE_SIZE; i++) {
+                int x = originX + (i & (GRID_TILE_SIZE - 1));
+                int y = originY + (i >> GRID_TILE_SHIFT);
+                if(x < storage->width && y < storage->height) {
+                    function(cells[i], x, y);
+                }
+            }
+        }
+    }
+
+    /*
+     * Frees every allocated tile none of whose cells satisfy keep(cell), so the next evaluation starts from
+     * the tiles that matter (e.g. those holding tags) instead of every tile earlier evaluations touched.
+     * Must not run while the grid is in use elsewhere.
+     */
+    template <class Predicate>
+    void releaseTilesExcept(Predicate keep) {
+        std::vector<int> keptTiles;
+        for(int tile : storage->allocatedTiles) {
+            std::vector<Cell*>& cells = storage->tiles[tile];
+            bool kept = false;
+            for(Cell* cell : cells) {
+                if(keep(cell)) {
+                    kept = true;
+                    break;
+                }
+            }
+            if(kept) {
+                keptTiles.push_back(tile);
+            }
+            else {
+                std::vector<Cell*>().swap(cells);
+            }
+        }
+        if(keptTiles.size() != storage->allocatedTiles.size()) {
+            storage->allocatedTiles.swap(keptTiles);
+            storage->releaseCount++;
+        }
+    }
+
+    int allocatedTileCount() const {return storage ? (int)storage->allocatedTiles.size() : 0;}
+    uint64_t releaseCount() const {return storage ? storage->releaseCount : 0;}
+    void tagsLaidOut() {storage->layoutCount.fetch_add(1, std::memory_order_release);}
+    uint64_t layoutCount() const {return storage ? storage->layoutCount.load(std::memory_order_acquire) : 0;}
+    bool sharesCellsWith(const TiledGrid& other) const {return storage && storage == other.storage;}
+};
+
+#endif
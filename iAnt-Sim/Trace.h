@@ -0,0 +1,468 @@
+#import <Foundation/Foundation.h>
+
+#ifdef __cplusplus
+
+#import <zlib.h>
+#import <cstdio>
+#import <cstring>
+#import <string>
+#import <vector>
+
+#define TRACE_MAGIC "IANTTRC1"
+#define TRACE_INDEX_MAGIC "IANTIDX1"
+#define TRACE_VERSION 1
+#define TRACE_DEFAULT_KEYFRAME_INTERVAL 100 //Ticks per independently compressed chunk.
+
+/*
+ * Binary trace of one evaluation: robot positions and states every tick, plus tag pickups and pheromone deposits.
+ *
+ * Layout: header | chunks | index | footer.
+ * Ticks are grouped into chunks that are zlib-compressed on their own, and the index at the end of the file
+ * gives the first tick and offset of each chunk, so a reader can seek to any tick by inflating a single chunk.
+ * Within a chunk every robot field is stored as a (zigzag varint) delta from the previous tick, and the first tick
+ * of a chunk is a delta from zero, i.e. a keyframe.
+ *
+ * Raw tick record: tick delta | per robot: dx, dy, status ^ previous status | pickups: count, (robot, x, y)* |
+ * pheromones: count, (x, y, weight as 4 raw bytes)*.
+ * Multi-byte fixed fields are little-endian.
+ */
+struct TraceRobot {
+    int x;
+    int y;
+    int status;
+};
+
+struct TracePickup {
+    int robot;
+    int x;
+    int y;
+};
+
+struct TracePheromone {
+    int x;
+    int y;
+    float weight;
+};
+
+struct TraceChunk {
+    int firstTick;
+    int tickCount;
+    uint64_t offset;
+    uint32_t compressedSize;
+    uint32_t rawSize;
+};
+
+static inline void tracePutVarint(std::vector<uint8_t>& buffer, uint32_t value) {
+    while(value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+
+static inline void tracePutSigned(std::vector<uint8_t>& buffer, int value) {
+    tracePutVarint(buffer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static inline void tracePutFixed(std::vector<uint8_t>& buffer, uint64_t value, int bytes) {
+    for(int i = 0; i < bytes; i++) {
+        buffer.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static inline uint32_t traceGetVarint(const uint8_t*& cursor) {
+    uint32_t value = 0;
+    for(int shift = 0; ; shift += 7) {
+        uint8_t byte = *cursor++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+static inline int traceGetSigned(const uint8_t*& cursor) {
+    uint32_t value = traceGetVarint(cursor);
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static inline uint64_t traceGetFixed(const uint8_t*& cursor, int bytes) {
+    uint64_t value = 0;
+    for(int i = 0; i < bytes; i++) {
+        value |= (uint64_t)*cursor++ << (8 * i);
+    }
+    return value;
+}
+
+/*
+ * Writes a trace tick by tick. Call setRobot for every robot and record* for each event, then endTick.
+ * Not thread-safe; the kernel must run on one thread while tracing.
+ */
+class TraceWriter {
+    FILE* file;
+    std::string path;
+    bool failed; //A chunk could not be compressed or written; the file is deleted on close.
+    int robotCount;
+    int keyframeInterval;
+
+    std::vector<TraceRobot> current;
+    std::vector<TraceRobot> previous; //Zeroed at every chunk start.
+    std::vector<TracePickup> pickups;
+    std::vector<TracePheromone> pheromones;
+
+    std::vector<uint8_t> raw; //Current chunk, uncompressed.
+    std::vector<uint8_t> compressed;
+    std::vector<TraceChunk> index;
+    int chunkFirstTick;
+    int chunkTickCount;
+    int lastTick;
+    uint64_t offset;
+
+    void write(const std::vector<uint8_t>& bytes) {
+        if(failed) {
+            return;
+        }
+        if(fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+            failed = true;
+        }
+        offset += bytes.size();
+    }
+
+    void flushChunk() {
+        if(!chunkTickCount) {
+            return;
+        }
+        uLongf size = compressBound(raw.size());
+        compressed.resize(size);
+        if(compress2(compressed.data(), &size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK) {
+            failed = true;
+        }
+        compressed.resize(size);
+
+        TraceChunk chunk = {chunkFirstTick, chunkTickCount, offset, (uint32_t)size, (uint32_t)raw.size()};
+        index.push_back(chunk);
+        write(compressed);
+
+        raw.clear();
+        chunkTickCount = 0;
+    }
+
+public:
+    TraceWriter() : file(NULL), failed(false) {}
+    ~TraceWriter() {close();}
+
+    /*
+     * Starts a new trace file; returns false if it can't be created.
+     */
+    bool open(const char* _path, int _robotCount, int width, int height, int _keyframeInterval = TRACE_DEFAULT_KEYFRAME_INTERVAL) {
+        close();
+        file = fopen(_path, "wb");
+        if(!file) {
+            return false;
+        }
+        path = _path;
+        failed = false;
+        robotCount = _robotCount;
+        keyframeInterval = MAX(_keyframeInterval, 1);
+        current.assign(robotCount, TraceRobot());
+        previous.assign(robotCount, TraceRobot());
+        pickups.clear();
+        pheromones.clear();
+        raw.clear();
+        index.clear();
+        chunkTickCount = 0;
+        lastTick = 0;
+        offset = 0;
+
+        std::vector<uint8_t> header(TRACE_MAGIC, TRACE_MAGIC + 8);
+        tracePutFixed(header, TRACE_VERSION, 4);
+        tracePutFixed(header, robotCount, 4);
+        tracePutFixed(header, width, 4);
+        tracePutFixed(header, height, 4);
+        tracePutFixed(header, keyframeInterval, 4);
+        write(header);
+        return true;
+    }
+
+    bool isOpen() const {return file != NULL;}
+    bool hasFailed() const {return failed;}
+
+    void setRobot(int robot, int x, int y, int status) {
+        TraceRobot state = {x, y, status};
+        current[robot] = state;
+    }
+
+    void recordPickup(int robot, int x, int y) {
+        TracePickup pickup = {robot, x, y};
+        pickups.push_back(pickup);
+    }
+
+    void recordPheromone(int x, int y, float weight) {
+        TracePheromone pheromone = {x, y, weight};
+        pheromones.push_back(pheromone);
+    }
+
+    /*
+     * Appends the robot states and events gathered since the last call as tick.
+     */
+    void endTick(int tick) {
+        if(chunkTickCount == keyframeInterval) {
+            flushChunk();
+        }
+        if(!chunkTickCount) {
+            chunkFirstTick = lastTick = tick;
+            previous.assign(robotCount, TraceRobot());
+        }
+
+        tracePutVarint(raw, tick - lastTick);
+        for(int i = 0; i < robotCount; i++) {
+            tracePutSigned(raw, current[i].x - previous[i].x);
+            tracePutSigned(raw, current[i].y - previous[i].y);
+            tracePutVarint(raw, current[i].status ^ previous[i].status);
+        }
+        previous = current;
+
+        tracePutVarint(raw, (uint32_t)pickups.size());
+        for(const TracePickup& pickup : pickups) {
+            tracePutVarint(raw, pickup.robot);
+            tracePutSigned(raw, pickup.x);
+            tracePutSigned(raw, pickup.y);
+        }
+        tracePutVarint(raw, (uint32_t)pheromones.size());
+        for(const TracePheromone& pheromone : pheromones) {
+            uint32_t weight;
+            memcpy(&weight, &pheromone.weight, sizeof(weight));
+            tracePutSigned(raw, pheromone.x);
+            tracePutSigned(raw, pheromone.y);
+            tracePutFixed(raw, weight, 4);
+        }
+        pickups.clear();
+        pheromones.clear();
+
+        lastTick = tick;
+        chunkTickCount++;
+    }
+
+    /*
+     * Flushes the last chunk and writes the tick index.
+     * Returns false if anything could not be written, in which case the incomplete file is deleted.
+     */
+    bool close() {
+        if(!file) {
+            return true;
+        }
+        flushChunk();
+
+        uint64_t indexOffset = offset;
+        std::vector<uint8_t> footer;
+        for(const TraceChunk& chunk : index) {
+            tracePutFixed(footer, chunk.firstTick, 4);
+            tracePutFixed(footer, chunk.tickCount, 4);
+            tracePutFixed(footer, chunk.offset, 8);
+            tracePutFixed(footer, chunk.compressedSize, 4);
+            tracePutFixed(footer, chunk.rawSize, 4);
+        }
+        tracePutFixed(footer, indexOffset, 8);
+        tracePutFixed(footer, index.size(), 4);
+        footer.insert(footer.end(), TRACE_INDEX_MAGIC, TRACE_INDEX_MAGIC + 8);
+        write(footer);
+
+        failed = (fclose(file) != 0) || failed;
+        file = NULL;
+        if(failed) {
+            remove(path.c_str());
+        }
+        return !failed;
+    }
+};
+
+/*
+ * Reads a trace written by TraceWriter. seek jumps to any recorded tick by inflating only the chunk holding it;
+ * next steps forward one recorded tick.
+ */
+class TraceReader {
+    FILE* file;
+    int robotCount;
+    int width;
+    int height;
+    std::vector<TraceChunk> index;
+
+    int chunk; //Index of the inflated chunk, -1 if none.
+    std::vector<uint8_t> raw;
+    const uint8_t* cursor;
+    int ticksLeft; //Ticks of the inflated chunk not yet decoded.
+
+    int currentTick;
+    std::vector<TraceRobot> robots;
+    std::vector<TracePickup> pickups;
+    std::vector<TracePheromone> pheromones;
+
+    bool readAt(uint64_t position, std::vector<uint8_t>& bytes, size_t size) {
+        bytes.resize(size);
+        return !fseeko(file, position, SEEK_SET) && (fread(bytes.data(), 1, size, file) == size);
+    }
+
+    bool loadChunk(int _chunk) {
+        std::vector<uint8_t> compressed;
+        if(!readAt(index[_chunk].offset, compressed, index[_chunk].compressedSize)) {
+            return false;
+        }
+        raw.resize(index[_chunk].rawSize);
+        uLongf size = raw.size();
+        if(uncompress(raw.data(), &size, compressed.data(), compressed.size()) != Z_OK || size != raw.size()) {
+            return false;
+        }
+        chunk = _chunk;
+        cursor = raw.data();
+        ticksLeft = index[_chunk].tickCount;
+        currentTick = index[_chunk].firstTick;
+        robots.assign(robotCount, TraceRobot());
+        return true;
+    }
+
+    void decodeTick() {
+        currentTick += traceGetVarint(cursor);
+        for(TraceRobot& robot : robots) {
+            robot.x += traceGetSigned(cursor);
+            robot.y += traceGetSigned(cursor);
+            robot.status ^= traceGetVarint(cursor);
+        }
+
+        pickups.resize(traceGetVarint(cursor));
+        for(TracePickup& pickup : pickups) {
+            pickup.robot = traceGetVarint(cursor);
+            pickup.x = traceGetSigned(cursor);
+            pickup.y = traceGetSigned(cursor);
+        }
+        pheromones.resize(traceGetVarint(cursor));
+        for(TracePheromone& pheromone : pheromones) {
+            pheromone.x = traceGetSigned(cursor);
+            pheromone.y = traceGetSigned(cursor);
+            uint32_t weight = (uint32_t)traceGetFixed(cursor, 4);
+            memcpy(&pheromone.weight, &weight, sizeof(weight));
+        }
+        ticksLeft--;
+    }
+
+public:
+    TraceReader() : file(NULL), robotCount(0), chunk(-1) {}
+    ~TraceReader() {close();}
+
+    /*
+     * Opens a trace and loads its index; returns false if it is missing, truncated or not a trace.
+     * Afterwards no tick is current until seek or next is called.
+     */
+    bool open(const char* path) {
+        close();
+        file = fopen(path, "rb");
+        if(!file) {
+            return false;
+        }
+
+        std::vector<uint8_t> bytes;
+        if(!readAt(0, bytes, 28) || memcmp(bytes.data(), TRACE_MAGIC, 8)) {
+            close();
+            return false;
+        }
+        const uint8_t* header = bytes.data() + 8;
+        if(traceGetFixed(header, 4) != TRACE_VERSION) {
+            close();
+            return false;
+        }
+        robotCount = (int)traceGetFixed(header, 4);
+        width = (int)traceGetFixed(header, 4);
+        height = (int)traceGetFixed(header, 4);
+
+        fseeko(file, 0, SEEK_END);
+        off_t size = ftello(file);
+        if(size < 48 || !readAt(size - 20, bytes, 20) || memcmp(bytes.data() + 12, TRACE_INDEX_MAGIC, 8)) {
+            close();
+            return false;
+        }
+        const uint8_t* footer = bytes.data();
+        uint64_t indexOffset = traceGetFixed(footer, 8);
+        uint32_t chunkCount = (uint32_t)traceGetFixed(footer, 4);
+        if(!readAt(indexOffset, bytes, (size_t)chunkCount * 24)) {
+            close();
+            return false;
+        }
+        index.resize(chunkCount);
+        const uint8_t* entry = bytes.data();
+        for(TraceChunk& chunkEntry : index) {
+            chunkEntry.firstTick = (int)traceGetFixed(entry, 4);
+            chunkEntry.tickCount = (int)traceGetFixed(entry, 4);
+            chunkEntry.offset = traceGetFixed(entry, 8);
+            chunkEntry.compressedSize = (uint32_t)traceGetFixed(entry, 4);
+            chunkEntry.rawSize = (uint32_t)traceGetFixed(entry, 4);
+        }
+        chunk = -1;
+        ticksLeft = 0;
+        return true;
+    }
+
+    void close() {
+        if(file) {
+            fclose(file);
+            file = NULL;
+        }
+        index.clear();
+        chunk = -1;
+    }
+
+    int getRobotCount() const {return robotCount;}
+    int getWidth() const {return width;}
+    int getHeight() const {return height;}
+    int firstTick() const {return index.empty() ? -1 : index.front().firstTick;}
+    int tick() const {return currentTick;}
+
+    const std::vector<TraceRobot>& getRobots() const {return robots;}
+    const std::vector<TracePickup>& getPickups() const {return pickups;} //Events of the current tick only.
+    const std::vector<TracePheromone>& getPheromones() const {return pheromones;}
+
+    /*
+     * Makes the latest recorded tick at or before tick current; returns false if there is none.
+     */
+    bool seek(int tick) {
+        int lowest = 0, highest = (int)index.size() - 1, found = -1;
+        while(lowest <= highest) {
+            int middle = (lowest + highest) / 2;
+            if(index[middle].firstTick <= tick) {
+                found = middle;
+                lowest = middle + 1;
+            }
+            else {
+                highest = middle - 1;
+            }
+        }
+        if(found < 0 || !loadChunk(found)) {
+            return false;
+        }
+
+        //Decode up to the target, stopping short of any tick past it.
+        decodeTick();
+        while(ticksLeft) {
+            const uint8_t* start = cursor;
+            uint32_t delta = traceGetVarint(start);
+            if(currentTick + (int)delta > tick) {
+                break;
+            }
+            decodeTick();
+        }
+        return true;
+    }
+
+    /*
+     * Advances to the next recorded tick; returns false at the end of the trace.
+     */
+    bool next() {
+        if(!ticksLeft) {
+            if((chunk + 1 >= (int)index.size()) || !loadChunk(chunk + 1)) {
+                return false;
+            }
+        }
+        decodeTick();
+        return true;
+    }
+};
+
+#endif
@@ -1,4 +1,9 @@
 #import <Foundation/Foundation.h>
+#ifdef __APPLE__
+#import <mach/mach_time.h>
+#else
+#import <time.h>
+#endif
 
 @interface Utilities : NSObject
 
@@ -8,11 +13,44 @@
 
 //*NOTE* These functions moved from Util.h -- may be converted to Obj-C in the future
 
+/*
+ * If set, random draws on this thread come from this generator state instead of random().
+ * Lets concurrent workers give every robot its own reproducible stream.
+ */
+extern __thread uint64_t* threadRandomState;
+
+/*
+ * Returns a random integer in the range [0,RAND_MAX], the same range as random().
+ */
+static inline long nextRandom() {
+    if(threadRandomState) {
+        //xorshift64*
+        uint64_t x = *threadRandomState;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        *threadRandomState = x;
+        return (long)((x * 2685821657736338717ULL) >> 33);
+    }
+    return random();
+}
+
+/*
+ * Returns a generator state for threadRandomState derived from seed (splitmix64; never zero).
+ */
+static inline uint64_t randomStateFromSeed(uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return z ? z : 1;
+}
+
 /*
  * Returns a random float in the range [0,x].
  */
 static inline float randomFloat(float x) {
-    return ((float)random() / ((long)RAND_MAX + 1)) * x;
+    return ((float)nextRandom() / ((long)RAND_MAX + 1)) * x;
 }
 
 /*
@@ -26,7 +64,7 @@ static inline float randomFloatRange(float x, float y) {
  * Returns a random integer in the range [0,x).
  */
 static inline int randomInt(int x) {
-    return random() % x; //Note that modulo bias does exist here.
+    return nextRandom() % x; //Note that modulo bias does exist here.
 }
 
 /*
@@ -159,4 +197,36 @@ static inline float bic(float ll, int k, int n) {
  */
 static inline int componentsEM(int k, int d) {
     return (k - 1) + (k * d) + (k * ((d * (d - 1)) / 2));
-}
\ No newline at end of file
+}
+
+/*
+ * Returns the 64-bit FNV-1a hash of length bytes, continuing from seed.
+ * Pass FNV_OFFSET_BASIS as seed to start a new hash.
+ */
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+static inline uint64_t hashBytes(const void* bytes, size_t length, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)bytes;
+    uint64_t hash = seed;
+    for(size_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Returns seconds on a monotonic clock with an arbitrary origin, for timing intervals.
+ */
+static inline double monotonicSeconds() {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if(timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (mach_absolute_time() * (double)timebase.numer / timebase.denom) * 1e-9;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec * 1e-9);
+#endif
+}
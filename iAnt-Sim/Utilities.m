@@ -1,5 +1,7 @@
 #import "Utilities.h"
 
+__thread uint64_t* threadRandomState = NULL;
+
 @implementation Utilities
 
 + (void)appendText:(NSString *)text toFile:(NSString *)filePath {